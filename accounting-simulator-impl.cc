@@ -0,0 +1,350 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) October 2021 : R. Olusegun Alli-Oke
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: R. Olusegun Alli-Oke <razkgb2012@gmail.com>, <razak.alli-oke@elizadeuniversity.edu.ng>
+ */
+
+#include "accounting-simulator-impl.h"
+#include "ns3/event-impl.h"
+#include "ns3/log.h"
+#include <cxxabi.h>
+#include <execinfo.h>           //backtrace_symbols
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("AccountingSimulatorImpl");
+
+NS_OBJECT_ENSURE_REGISTERED (AccountingSimulatorImpl);
+
+namespace {
+
+//layouts of the events built by MakeEvent (make-event.h): EventMemberImplN holds the object (a raw pointer or a Ptr, one
+//pointer either way) and then the member function pointer; EventFunctionImplN holds the function pointer first
+class MemberEventLayout : public EventImpl
+{
+public:
+  void *obj;
+  void (MemberEventLayout::*function) (void);
+private:
+  virtual void Notify (void)
+  {
+  }
+};
+
+class FunctionEventLayout : public EventImpl
+{
+public:
+  void (*function) (void);
+private:
+  virtual void Notify (void)
+  {
+  }
+};
+
+std::string
+Demangle (const char *mangled)
+{
+  int status = 0;
+  char *demangled = abi::__cxa_demangle (mangled, 0, 0, &status);
+  std::string name = (status == 0 && demangled) ? demangled : mangled;
+  std::free (demangled);
+  return name;
+}
+
+//the scheduled event: runs and times the original one
+class TimedEvent : public EventImpl
+{
+public:
+  TimedEvent (EventImpl *event, Ptr<AccountingSimulatorImpl::Table> table, uint32_t tag)
+    : m_event (event, false),
+      m_table (table),
+      m_tag (tag),
+      m_executed (false)
+  {
+  }
+
+  virtual ~TimedEvent ()
+  {
+    if (!m_executed)
+      {
+        ++m_table->counters[m_tag].discarded;
+      }
+  }
+
+protected:
+  virtual void Notify (void)
+  {
+    m_executed = true;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+    m_event->Invoke ();
+    AccountingSimulatorImpl::Counters &c = m_table->counters[m_tag];   //after the handler: it may have added tags
+    ++c.executed;
+    c.seconds += std::chrono::duration<double> (std::chrono::steady_clock::now () - start).count ();
+  }
+
+private:
+  Ptr<EventImpl> m_event;                               //!< the original event
+  Ptr<AccountingSimulatorImpl::Table> m_table;          //!< the counters
+  uint32_t m_tag;                                       //!< handler of the original event
+  bool m_executed;                                      //!< the original event was run
+};
+
+} // anonymous namespace
+
+TypeId
+AccountingSimulatorImpl::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::AccountingSimulatorImpl")
+    .SetParent<DefaultSimulatorImpl> ()
+    .SetGroupName ("TrafficControl")
+    .AddConstructor<AccountingSimulatorImpl> ()
+  ;
+  return tid;
+}
+
+AccountingSimulatorImpl::AccountingSimulatorImpl ()
+  : m_table (Create<Table> ()),
+    m_runSeconds (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+AccountingSimulatorImpl::~AccountingSimulatorImpl ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+EventId
+AccountingSimulatorImpl::Schedule (const Time &delay, EventImpl *event)
+{
+  return DefaultSimulatorImpl::Schedule (delay, Wrap (event));
+}
+
+void
+AccountingSimulatorImpl::ScheduleWithContext (uint32_t context, const Time &delay, EventImpl *event)
+{
+  DefaultSimulatorImpl::ScheduleWithContext (context, delay, Wrap (event));
+}
+
+EventId
+AccountingSimulatorImpl::ScheduleNow (EventImpl *event)
+{
+  return DefaultSimulatorImpl::ScheduleNow (Wrap (event));
+}
+
+void
+AccountingSimulatorImpl::Run (void)
+{
+  NS_LOG_FUNCTION (this);
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+  DefaultSimulatorImpl::Run ();
+  m_runSeconds += std::chrono::duration<double> (std::chrono::steady_clock::now () - start).count ();
+}
+
+EventImpl *
+AccountingSimulatorImpl::Wrap (EventImpl *event)
+{
+  std::type_index type (typeid (*event));
+  std::unordered_map<std::type_index, std::pair<Table::Kind, std::string> >::const_iterator t = m_table->types.find (type);
+  if (t == m_table->types.end ())
+    {
+      t = m_table->types.emplace (type, std::make_pair (EventKind (typeid (*event)), HandlerName (typeid (*event)))).first;
+    }
+
+  Table::Key key = {type, 0, 0};
+  if (t->second.first == Table::MEMBER)
+    {
+      //Itanium C++ ABI: a member function pointer is the function address (or vtable offset + 1) and a this adjustment
+      static_assert (sizeof (MemberEventLayout::function) == 2 * sizeof (uintptr_t), "unexpected member function pointer size");
+      uintptr_t bits[2];
+      std::memcpy (bits, &static_cast<MemberEventLayout *> (event)->function, sizeof (bits));
+      key.ptr = bits[0];
+      key.adj = bits[1];
+    }
+  else if (t->second.first == Table::FUNCTION)
+    {
+      key.ptr = reinterpret_cast<uintptr_t> (static_cast<FunctionEventLayout *> (event)->function);
+    }
+
+  std::unordered_map<Table::Key, uint32_t, Table::KeyHash>::const_iterator it = m_table->tags.find (key);
+  uint32_t tag;
+  if (it != m_table->tags.end ())
+    {
+      tag = it->second;
+    }
+  else
+    {
+      tag = m_table->counters.size ();
+      m_table->tags.emplace (key, tag);
+      m_table->counters.push_back (Counters ());
+      void *function = reinterpret_cast<void *> (key.ptr);
+      if (t->second.first == Table::MEMBER && (key.ptr & 1))
+        {
+          //virtual: the function in the vtable of the bound object (of the first event of this slot)
+          void *obj = static_cast<MemberEventLayout *> (event)->obj;
+          void **vtable = obj ? *reinterpret_cast<void ***> (static_cast<char *> (obj) + key.adj) : 0;
+          function = vtable ? vtable[(key.ptr - 1) / sizeof (void *)] : 0;
+        }
+      std::string name = (t->second.first == Table::OTHER || !function) ? "" : SymbolName (function);
+      if (name.empty ())
+        {
+          std::ostringstream oss;
+          oss << t->second.second;
+          if (t->second.first != Table::OTHER)
+            {
+              oss << " @ " << function;
+            }
+          name = oss.str ();
+        }
+      m_table->counters.back ().name = name;
+    }
+  ++m_table->counters[tag].scheduled;
+  return new TimedEvent (event, m_table, tag);
+}
+
+std::string
+AccountingSimulatorImpl::HandlerName (const std::type_info &type)
+{
+  std::string name = Demangle (type.name ());
+
+  //ns3::MakeEvent<...>(MEM, OBJ, ...)::EventMemberImplN -> MEM, OBJ, ...   (MakeEvent (void (*)()) is no template)
+  const std::string prefix = "ns3::MakeEvent";
+  if (name.compare (0, prefix.size (), prefix) != 0)
+    {
+      return name;
+    }
+  std::string::size_type i = prefix.size ();
+  std::string::size_type begin = 0;
+  int depth = 0;
+  do
+    {
+      if (name[i] == '<' || name[i] == '(')
+        {
+          ++depth;
+          begin = (depth == 1 && name[i] == '(') ? i + 1 : begin;
+        }
+      else if ((name[i] == '>' || name[i] == ')') && --depth == 0 && begin > 0)
+        {
+          return name.substr (begin, i - begin);
+        }
+    }
+  while (++i < name.size () && (depth > 0 || name[i] == '('));
+  return name;
+}
+
+AccountingSimulatorImpl::Table::Kind
+AccountingSimulatorImpl::EventKind (const std::type_info &type)
+{
+  std::string name = Demangle (type.name ());
+  if (name.compare (0, 14, "ns3::MakeEvent") != 0)
+    {
+      return Table::OTHER;
+    }
+  //the arguments of MakeEvent, split at the top-level commas
+  std::string args = HandlerName (type);
+  std::vector<std::string> list (1);
+  int depth = 0;
+  for (char ch : args)
+    {
+      depth += (ch == '<' || ch == '(') - (ch == '>' || ch == ')');
+      if (ch == ',' && depth == 0)
+        {
+          list.push_back ("");
+        }
+      else if (ch != ' ' || !list.back ().empty ())
+        {
+          list.back () += ch;
+        }
+    }
+  if (name.find ("::EventMemberImpl") != std::string::npos && list.size () >= 2)
+    {
+      const std::string &obj = list[1];
+      bool pointer = (!obj.empty () && obj[obj.size () - 1] == '*') || obj.compare (0, 9, "ns3::Ptr<") == 0;
+      return pointer ? Table::MEMBER : Table::OTHER;
+    }
+  if (name.find ("::EventFunctionImpl") != std::string::npos && list[0].find ("(*)") != std::string::npos)
+    {
+      return Table::FUNCTION;
+    }
+  return Table::OTHER;
+}
+
+std::string
+AccountingSimulatorImpl::SymbolName (void *address)
+{
+  //"file(symbol+0) [address]": only an exact match is the function (a static one is reported as an offset to another)
+  char **symbols = backtrace_symbols (&address, 1);
+  if (!symbols)
+    {
+      return "";
+    }
+  std::string line = symbols[0];
+  std::free (symbols);
+  std::string::size_type open = line.find ('(');
+  std::string::size_type plus = (open == std::string::npos) ? open : line.find ('+', open);
+  std::string::size_type close = (plus == std::string::npos) ? plus : line.find (')', plus);
+  if (close == std::string::npos || plus == open + 1 || std::strtoul (line.substr (plus + 1, close - plus - 1).c_str (), 0, 16) != 0)
+    {
+      return "";
+    }
+  return Demangle (line.substr (open + 1, plus - open - 1).c_str ());
+}
+
+void
+AccountingSimulatorImpl::Report (std::ostream &os) const
+{
+  std::vector<const Counters *> sorted;
+  Counters total;
+  for (const Counters &c : m_table->counters)
+    {
+      sorted.push_back (&c);
+      total.scheduled += c.scheduled;
+      total.executed += c.executed;
+      total.discarded += c.discarded;
+      total.seconds += c.seconds;
+    }
+  std::sort (sorted.begin (), sorted.end (),
+             [] (const Counters *a, const Counters *b) { return a->seconds > b->seconds; });
+
+  os << "\nevent accounting (by handler, decreasing handler time)" << std::endl;
+  os << std::right << std::setw (12) << "scheduled" << std::setw (12) << "executed" << std::setw (12) << "discarded"
+     << std::setw (12) << "time(s)" << std::setw (10) << "share" << std::setw (12) << "mean(ns)" << "  handler" << std::endl;
+  for (const Counters *c : sorted)
+    {
+      os << std::setw (12) << c->scheduled << std::setw (12) << c->executed << std::setw (12) << c->discarded
+         << std::setw (12) << std::fixed << std::setprecision (3) << c->seconds
+         << std::setw (9) << std::setprecision (1) << (total.seconds > 0 ? 100 * c->seconds / total.seconds : 0) << "%"
+         << std::setw (12) << std::setprecision (0) << (c->executed > 0 ? 1e9 * c->seconds / c->executed : 0)
+         << "  " << c->name << std::defaultfloat << std::setprecision (6) << std::endl;
+    }
+  os << std::setw (12) << total.scheduled << std::setw (12) << total.executed << std::setw (12) << total.discarded
+     << std::setw (12) << std::fixed << std::setprecision (3) << total.seconds << std::defaultfloat << std::setprecision (6)
+     << "            total" << std::endl;
+  double loop = m_runSeconds - total.seconds;
+  os << "Run: " << m_runSeconds << " s wall, " << total.executed / std::max (m_runSeconds, 1e-9) << " events/s; "
+     << "outside the handlers (scheduler, accounting): " << loop << " s, "
+     << (total.executed > 0 ? 1e9 * loop / total.executed : 0) << " ns/event\n" << std::endl;
+}
+
+} // namespace ns3
@@ -0,0 +1,167 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) October 2021 : R. Olusegun Alli-Oke
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: R. Olusegun Alli-Oke <razkgb2012@gmail.com>, <razak.alli-oke@elizadeuniversity.edu.ng>
+ */
+
+
+#ifndef ACCOUNTING_SIMULATOR_IMPL_H
+#define ACCOUNTING_SIMULATOR_IMPL_H
+
+#include "ns3/default-simulator-impl.h"
+#include "ns3/simple-ref-count.h"
+#include <stdint.h>
+#include <chrono>
+#include <deque>
+#include <ostream>
+#include <string>
+#include <typeindex>
+#include <unordered_map>
+#include <utility>
+
+
+namespace ns3 {
+
+/**
+ * \ingroup traffic-control
+ *
+ * \brief DefaultSimulatorImpl that accounts the events by handler: events scheduled, executed and discarded
+ *        (cancelled, removed, or still pending at Simulator::Destroy), and the wall-clock time spent in the handlers.
+ *
+ * Every scheduled event is wrapped in an event that times the original one. Events are tagged by the function they
+ * run: C++ does not put the function into the type of the event MakeEvent builds (handlers of the same class with the
+ * same signature, e.g. PidQueueDisc::CalculateP and QSizeRefUpdate, or the retransmit, delayed-ACK and persist
+ * timeouts of TcpSocketBase, have the same event type), so the function pointer is read from the event, whose layout
+ * is that of make-event.h (the bound object, then the member function pointer; or the function pointer first). The
+ * row is named after the function symbol (the address if the symbol is not exported, e.g. a static function of a
+ * script); events of other types are tagged by their type. The wrapper
+ * costs one allocation and two clock reads per event, so absolute event rates are lower than with
+ * DefaultSimulatorImpl; the shares are what to compare. Events scheduled from other threads are not supported.
+ *
+ * Select with GlobalValue::Bind ("SimulatorImplementationType", StringValue ("ns3::AccountingSimulatorImpl")) before
+ * any event is scheduled, and print with Report () after Simulator::Run ().
+ */
+class AccountingSimulatorImpl : public DefaultSimulatorImpl
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  AccountingSimulatorImpl ();
+  virtual ~AccountingSimulatorImpl ();
+
+  // Inherited
+  virtual EventId Schedule (const Time &delay, EventImpl *event);
+  virtual void ScheduleWithContext (uint32_t context, const Time &delay, EventImpl *event);
+  virtual EventId ScheduleNow (EventImpl *event);
+  virtual void Run (void);
+
+  /**
+   * \brief Print the counters of every handler, by decreasing handler time, and the totals
+   * \param os the output stream
+   */
+  void Report (std::ostream &os) const;
+
+  /// Counters of one handler
+  struct Counters
+  {
+    std::string name;                                   //!< handler function (or event type)
+    uint64_t scheduled = 0;                             //!< events inserted
+    uint64_t executed = 0;                              //!< events executed
+    uint64_t discarded = 0;                             //!< events destroyed without being executed
+    double seconds = 0;                                 //!< wall-clock time in the handlers
+  };
+
+  /// Counters of all the handlers, shared with the pending events (they may outlive the simulator)
+  class Table : public SimpleRefCount<Table>
+  {
+  public:
+    /// Event built by MakeEvent for a member function, for a function, or not (tagged by its type only)
+    enum Kind
+    {
+      MEMBER,
+      FUNCTION,
+      OTHER
+    };
+
+    /// Handler: event type, and the function pointer bits (pointer, this adjustment) read from the event
+    struct Key
+    {
+      std::type_index type;                             //!< event type
+      uintptr_t ptr;                                    //!< function pointer (vtable offset + 1 for a virtual member)
+      uintptr_t adj;                                    //!< this adjustment of a member function pointer
+
+      bool operator== (const Key &o) const
+      {
+        return type == o.type && ptr == o.ptr && adj == o.adj;
+      }
+    };
+
+    /// Hash of a handler key
+    struct KeyHash
+    {
+      std::size_t operator() (const Key &k) const
+      {
+        return std::hash<std::type_index> () (k.type) ^ std::hash<uintptr_t> () (k.ptr * 31 + k.adj);
+      }
+    };
+
+    std::deque<Counters> counters;                      //!< by tag (deque: references stay valid as tags are added)
+    std::unordered_map<std::type_index, std::pair<Kind, std::string> > types;   //!< kind and readable name of each event type
+    std::unordered_map<Key, uint32_t, KeyHash> tags;    //!< tag of each handler
+  };
+
+private:
+  /**
+   * \brief Wrap an event into a timed event of its handler
+   * \param event the event (ownership is taken)
+   * \returns the wrapping event
+   */
+  EventImpl *Wrap (EventImpl *event);
+
+  /**
+   * \brief Readable name of an event type: the template arguments of MakeEvent, or the demangled type name
+   * \param type the event type
+   * \returns the name
+   */
+  static std::string HandlerName (const std::type_info &type);
+
+  /**
+   * \brief Kind of an event type: built by MakeEvent for a member function bound to a pointer (raw or Ptr), for a
+   *        function pointer, or anything else
+   * \param type the event type
+   * \returns the kind
+   */
+  static Table::Kind EventKind (const std::type_info &type);
+
+  /**
+   * \brief Demangled name of the function at an address, if its symbol is exported
+   * \param address the function
+   * \returns the name, or empty
+   */
+  static std::string SymbolName (void *address);
+
+  Ptr<Table> m_table;                                   //!< the counters
+  double m_runSeconds;                                  //!< wall-clock time in Run
+};
+
+} // namespace ns3
+
+#endif /* ACCOUNTING_SIMULATOR_IMPL_H */
@@ -0,0 +1,317 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) October 2021 : R. Olusegun Alli-Oke
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: R. Olusegun Alli-Oke <razkgb2012@gmail.com>, <razak.alli-oke@elizadeuniversity.edu.ng>
+ */
+
+// ===========================================================================
+//
+// Comparison of the queue discs of the traffic-control module on the pid-script.cc workload (pid-dumbbell.h): the
+// same dumbbell, flows and seed for every disc, the disc installed on the bottleneck with
+// TrafficControlHelper::SetRootQueueDisc. The bottleneck TxQueue uses dynamic queue limits (BQL), so that the
+// backlog sits in the queue disc under test (PidQueueDisc then controls the disc + device backlog, "Total"), and
+// every disc gets the same buffer (MaxSize = qDiscLimit packets); TbfQueueDisc shapes at the bottleneck rate. The
+// other parameters are the module defaults, which can be changed from the command line as for any ns-3 program,
+// e.g. --ns3::PieQueueDisc::QueueDelayReference=+10ms.
+//
+// Each disc is run in a forked child, up to jobs at a time. Measured after the warm-up, until the sources stop:
+// queueing delay at the bottleneck disc (sojourn time: mean, p50, p90, p99, from a 0.1 ms histogram), utilization of
+// the bottleneck link, drop and mark rates of the disc; and the simulator cost of the whole run: wall time, executed
+// events, events per wall second and peak resident set. Reported as a table and as JSON.
+//
+// ./waf --run "aqm-compare-bench --flows=60 --simTime=60 --warmup=10 --jobs=4"
+//
+// This file is to be placed in "\\scratch" folder together with pid-dumbbell.h.
+//
+// ===========================================================================
+
+
+#include "pid-dumbbell.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unistd.h>             //fork, pipe, sysconf
+#include <sys/resource.h>       //rusage
+#include <sys/wait.h>           //wait4
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("AqmCompareBench");
+
+struct BenchResult
+{
+  double meanDelayMs;
+  double p50DelayMs;
+  double p90DelayMs;
+  double p99DelayMs;
+  double utilization;
+  double dropRate;
+  double markRate;
+  double setupSecs;
+  double runSecs;
+  uint64_t events;
+  uint64_t rxBytes;
+};
+
+//sojourn times and bottleneck transmissions, counted from the end of the warm-up
+class BottleneckMonitor
+{
+public:
+  static constexpr double BIN_MS = 0.1;
+  static const uint32_t BINS = 50000;           //up to 5 s; longer sojourns are counted in the last bin
+
+  BottleneckMonitor () : m_measuring (false), m_hist (BINS, 0), m_nSamples (0), m_sumMs (0), m_txBytes (0) {}
+
+  void Start (Ptr<QueueDisc> qd)
+  {
+    m_measuring = true;
+    m_start = Simulator::Now ();
+    m_stats0 = qd->GetStats ();
+  }
+
+  static void Sojourn (BottleneckMonitor *m, Time sojourn)
+  {
+    if (m->m_measuring)
+      {
+        double ms = sojourn.GetSeconds () * 1000;
+        ++m->m_hist[std::min<uint64_t> (static_cast<uint64_t> (ms / BIN_MS), BINS - 1)];
+        ++m->m_nSamples;
+        m->m_sumMs += ms;
+      }
+  }
+
+  static void PhyTxEnd (BottleneckMonitor *m, Ptr<const Packet> p)
+  {
+    if (m->m_measuring)
+      {
+        m->m_txBytes += p->GetSize ();
+      }
+  }
+
+  double MeanMs (void) const
+  {
+    return m_nSamples > 0 ? m_sumMs / m_nSamples : 0;
+  }
+
+  //upper edge of the bin holding the quantile
+  double PercentileMs (double q) const
+  {
+    uint64_t rank = static_cast<uint64_t> (q * (m_nSamples - 1)) + 1, seen = 0;
+    for (uint32_t b = 0; b < BINS && m_nSamples > 0; ++b)
+      {
+        seen += m_hist[b];
+        if (seen >= rank)
+          {
+            return (b + 1) * BIN_MS;
+          }
+      }
+    return 0;
+  }
+
+  bool m_measuring;
+  Time m_start;
+  QueueDisc::Stats m_stats0;
+  std::vector<uint64_t> m_hist;
+  uint64_t m_nSamples;
+  double m_sumMs;
+  uint64_t m_txBytes;
+};
+
+static BenchResult
+RunOnce (std::string qDiscType, uint32_t nFlows, uint32_t maxLeaves, uint32_t qDiscLimit, double simTime, double warmup)
+{
+  typedef std::chrono::steady_clock Clock;
+  DumbbellConfig cfg;
+  cfg.nFlows = nFlows;
+  cfg.maxLeaves = maxLeaves;
+  cfg.cstop = cfg.cstart + simTime;
+  cfg.qDiscType = qDiscType;
+  cfg.qDiscLimitPkts = qDiscLimit;
+  cfg.useBql = true;
+  SetPidScriptDefaults (cfg);
+  QueueSizeValue limit (QueueSize (QueueSizeUnit::PACKETS, qDiscLimit));
+  const char *discs[] = {"ns3::FifoQueueDisc", "ns3::RedQueueDisc", "ns3::CoDelQueueDisc", "ns3::FqCoDelQueueDisc", "ns3::PieQueueDisc",
+                         "ns3::CobaltQueueDisc", "ns3::TbfQueueDisc", "ns3::FqPidQueueDisc"};
+  for (const char *disc : discs)
+    {
+      Config::SetDefault (std::string (disc) + "::MaxSize", limit);
+    }
+
+  Clock::time_point t0 = Clock::now ();
+  Dumbbell db = BuildDumbbell (cfg);
+  DataRateValue rate;
+  db.bottleneckDevice->GetAttribute ("DataRate", rate);
+  if (qDiscType.find ("TbfQueueDisc") != std::string::npos)
+    {
+      db.bottleneckQueueDisc->SetAttribute ("Rate", rate);
+    }
+  BottleneckMonitor monitor;
+  db.bottleneckQueueDisc->TraceConnectWithoutContext ("SojournTime", MakeBoundCallback (&BottleneckMonitor::Sojourn, &monitor));
+  db.bottleneckDevice->TraceConnectWithoutContext ("PhyTxEnd", MakeBoundCallback (&BottleneckMonitor::PhyTxEnd, &monitor));
+  Simulator::Schedule (Seconds (cfg.cstart + warmup), &BottleneckMonitor::Start, &monitor, db.bottleneckQueueDisc);
+  Clock::time_point t1 = Clock::now ();
+  Simulator::Stop (Seconds (cfg.cstop));
+  Simulator::Run ();
+  Clock::time_point t2 = Clock::now ();
+
+  BenchResult r;
+  QueueDisc::Stats st = db.bottleneckQueueDisc->GetStats ();
+  double received = st.nTotalReceivedPackets - monitor.m_stats0.nTotalReceivedPackets;
+  double window = (Simulator::Now () - monitor.m_start).GetSeconds ();
+  r.meanDelayMs = monitor.MeanMs ();
+  r.p50DelayMs = monitor.PercentileMs (0.5);
+  r.p90DelayMs = monitor.PercentileMs (0.9);
+  r.p99DelayMs = monitor.PercentileMs (0.99);
+  r.utilization = (window > 0) ? monitor.m_txBytes * 8.0 / (rate.Get ().GetBitRate () * window) : 0;
+  r.dropRate = (received > 0) ? (st.nTotalDroppedPackets - monitor.m_stats0.nTotalDroppedPackets) / received : 0;
+  r.markRate = (received > 0) ? (st.nTotalMarkedPackets - monitor.m_stats0.nTotalMarkedPackets) / received : 0;
+  r.setupSecs = std::chrono::duration<double> (t1 - t0).count ();
+  r.runSecs = std::chrono::duration<double> (t2 - t1).count ();
+  r.events = Simulator::GetEventCount ();
+  r.rxBytes = 0;
+  for (uint32_t i = 0; i < db.sinks.GetN (); ++i)
+    {
+      r.rxBytes += DynamicCast<PacketSink> (db.sinks.Get (i))->GetTotalRx ();
+    }
+  Simulator::Destroy ();
+  return r;
+}
+
+
+int main (int argc, char *argv[])
+{
+    std::string discList = "ns3::PidQueueDisc<PID>,ns3::FqPidQueueDisc,ns3::FifoQueueDisc,ns3::RedQueueDisc,ns3::CoDelQueueDisc,"
+                           "ns3::FqCoDelQueueDisc,ns3::PieQueueDisc,ns3::CobaltQueueDisc,ns3::TbfQueueDisc";
+    uint32_t nFlows = 60;
+    uint32_t maxLeaves = 600;
+    uint32_t qDiscLimit = 800;
+    double simTime = 60;
+    double warmup = 10;
+    uint32_t jobs = std::max<long> (sysconf (_SC_NPROCESSORS_ONLN), 1);
+    std::string jsonFile = "aqm-compare.json";
+
+    CommandLine cmd;
+    cmd.AddValue ("discs", "comma-separated queue disc types", discList);
+    cmd.AddValue ("flows", "number of TCP flows", nFlows);
+    cmd.AddValue ("maxLeaves", "leaves per side (flows share leaves above this)", maxLeaves);
+    cmd.AddValue ("qDiscLimit", "MaxSize of every queue disc (packets)", qDiscLimit);
+    cmd.AddValue ("simTime", "simulated time of the flows (s)", simTime);
+    cmd.AddValue ("warmup", "time after the sources start before measuring (s)", warmup);
+    cmd.AddValue ("jobs", "runs in parallel", jobs);
+    cmd.AddValue ("json", "JSON report file", jsonFile);
+    cmd.Parse (argc, argv);
+    NS_ABORT_MSG_IF (warmup >= simTime, "warmup must be shorter than simTime");
+
+    std::vector<std::string> discs;
+    std::string item;
+    std::istringstream ds (discList);
+    while (std::getline (ds, item, ','))
+      {
+        discs.push_back (item);
+      }
+
+    //fork up to jobs children; each writes its result into its pipe and exits
+    std::vector<BenchResult> results (discs.size ());
+    std::vector<bool> ok (discs.size (), false);
+    std::vector<struct rusage> usage (discs.size ());
+    std::map<pid_t, std::pair<uint32_t, int> > running;         //child -> (disc, read end of its pipe)
+    uint32_t next = 0;
+    jobs = std::max<uint32_t> (jobs, 1);
+    std::cout << "running " << discs.size () << " queue discs, " << jobs << " at a time" << std::endl;
+    while (next < discs.size () || !running.empty ())
+      {
+        if (next < discs.size () && running.size () < jobs)
+          {
+            int fd[2];
+            NS_ABORT_MSG_IF (pipe (fd) != 0, "pipe failed");
+            std::cout.flush ();
+            pid_t pid = fork ();
+            NS_ABORT_MSG_IF (pid < 0, "fork failed");
+            if (pid == 0)
+              {
+                close (fd[0]);
+                BenchResult r = RunOnce (discs[next], nFlows, maxLeaves, qDiscLimit, simTime, warmup);
+                ssize_t w = write (fd[1], &r, sizeof (r));
+                _exit (w == sizeof (r) ? 0 : 1);
+              }
+            close (fd[1]);
+            running[pid] = std::make_pair (next++, fd[0]);
+            continue;
+          }
+        int status;
+        struct rusage ru;
+        pid_t pid = wait4 (-1, &status, 0, &ru);
+        NS_ABORT_MSG_IF (pid < 0, "wait4 failed");
+        std::map<pid_t, std::pair<uint32_t, int> >::iterator it = running.find (pid);
+        if (it == running.end ())
+          {
+            continue;
+          }
+        uint32_t d = it->second.first;
+        ok[d] = (read (it->second.second, &results[d], sizeof (BenchResult)) == sizeof (BenchResult));
+        usage[d] = ru;
+        close (it->second.second);
+        running.erase (it);
+      }
+
+    std::ostringstream json;
+    json << "{\n  \"benchmark\": \"aqm-compare\",\n  \"flows\": " << nFlows << ",\n  \"simTime\": " << simTime
+         << ",\n  \"warmup\": " << warmup << ",\n  \"qDiscLimit\": " << qDiscLimit << ",\n  \"runs\": [";
+    bool first = true;
+    std::cout << std::left << std::setw (26) << "queue disc" << std::right << std::setw (10) << "mean(ms)" << std::setw (10) << "p50(ms)"
+              << std::setw (10) << "p90(ms)" << std::setw (10) << "p99(ms)" << std::setw (8) << "util" << std::setw (10) << "drop"
+              << std::setw (10) << "mark" << std::setw (10) << "run(s)" << std::setw (14) << "events" << std::setw (12) << "events/s"
+              << std::setw (14) << "maxRSS(KB)" << std::endl;
+    for (uint32_t d = 0; d < discs.size (); ++d)
+      {
+        std::cout << std::left << std::setw (26) << discs[d] << std::right;
+        if (!ok[d])
+          {
+            std::cout << "  failed" << std::endl;
+            continue;
+          }
+        const BenchResult &r = results[d];
+        double eventsPerSec = r.events / r.runSecs;
+        std::cout << std::fixed << std::setprecision (2) << std::setw (10) << r.meanDelayMs << std::setw (10) << r.p50DelayMs
+                  << std::setw (10) << r.p90DelayMs << std::setw (10) << r.p99DelayMs << std::setw (8) << r.utilization
+                  << std::setprecision (5) << std::setw (10) << r.dropRate << std::setw (10) << r.markRate
+                  << std::setprecision (2) << std::setw (10) << r.runSecs << std::setw (14) << r.events
+                  << std::setw (12) << static_cast<uint64_t> (eventsPerSec) << std::setw (14) << usage[d].ru_maxrss
+                  << std::defaultfloat << std::setprecision (6) << std::endl;
+
+        json << (first ? "\n" : ",\n") << "    {\"queueDisc\": \"" << discs[d] << "\", \"meanDelayMs\": " << r.meanDelayMs
+             << ", \"p50DelayMs\": " << r.p50DelayMs << ", \"p90DelayMs\": " << r.p90DelayMs << ", \"p99DelayMs\": " << r.p99DelayMs
+             << ", \"utilization\": " << r.utilization << ", \"dropRate\": " << r.dropRate << ", \"markRate\": " << r.markRate
+             << ", \"setupSecs\": " << r.setupSecs << ", \"runSecs\": " << r.runSecs << ", \"events\": " << r.events
+             << ", \"eventsPerSec\": " << eventsPerSec << ", \"maxRssKB\": " << usage[d].ru_maxrss << ", \"rxBytes\": " << r.rxBytes << "}";
+        first = false;
+      }
+    json << "\n  ]\n}\n";
+
+    std::ofstream out (jsonFile.c_str ());
+    out << json.str ();
+    NS_ABORT_MSG_UNLESS (out, "cannot write " << jsonFile);
+    std::cout << "\nreport: " << jsonFile << std::endl;
+    return 0;
+}
@@ -0,0 +1,327 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) October 2021 : R. Olusegun Alli-Oke
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: R. Olusegun Alli-Oke <razkgb2012@gmail.com>, <razak.alli-oke@elizadeuniversity.edu.ng>
+ */
+
+// Text trace file written by a background thread. The simulation thread pushes fixed-size binary records (time, an
+// optional id, up to three values) into a single-producer/single-consumer ring; the writer thread formats them as
+// tab-separated lines, with the default stream formatting of the sinks it replaces, and writes them. The thread is
+// started at the first record and polls the ring (sleeping while it is empty), so pushing a record is a copy and two
+// atomic operations; when the ring is full, the simulation thread waits for the writer (no record is lost).
+//
+// Threads do not survive fork: the live writers are kept in a process-wide registry, and every one of them is stopped
+// (the remaining records are written and the file closed) by a pthread_atfork handler before any fork, or by StopAll ();
+// a writer restarts at its next record, appending to its file.
+//
+// Traces written to from several places (e.g. the drop probability of every PidQueueDisc) get one shared writer per
+// file (GetShared): one thread per file, and whole lines, however many sources append to it.
+
+
+#ifndef ASYNC_TRACE_WRITER_H
+#define ASYNC_TRACE_WRITER_H
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include <pthread.h>            //pthread_atfork
+
+
+namespace ns3 {
+
+/**
+ * \ingroup traffic-control
+ *
+ * \brief Trace file written by a background thread, fed by a single-producer/single-consumer ring of records
+ */
+class AsyncTraceWriter
+{
+public:
+  static const uint32_t MAX_VALUES = 4;                 //!< values per record
+
+  /// One line of the trace: [id \t] time \t value ...
+  struct Record
+  {
+    Record () : time (0), id (0), nValues (0), intMask (0) {}
+    explicit Record (double t, uint32_t i = 0) : time (t), id (i), nValues (0), intMask (0) {}
+
+    /// Append a value, printed as a double
+    Record &Add (double v)
+    {
+      values[nValues++] = v;
+      return *this;
+    }
+
+    /// Append a value, printed as an integer
+    Record &AddInt (uint32_t v)
+    {
+      intMask |= 1 << nValues;
+      values[nValues++] = v;
+      return *this;
+    }
+
+    double time;                                        //!< first column (second with an id)
+    double values[MAX_VALUES];                          //!< the next columns
+    uint32_t id;                                        //!< first column, if the writer has ids
+    uint8_t nValues;                                    //!< number of values
+    uint8_t intMask;                                    //!< values printed as integers (bit per value)
+  };
+
+  /**
+   * \param fileName the trace file
+   * \param append append to the file instead of truncating it at the first record
+   * \param withId the lines start with the record id
+   * \param capacity records in the ring (rounded up to a power of 2)
+   */
+  AsyncTraceWriter (std::string fileName, bool append = false, bool withId = false, uint32_t capacity = 65536)
+    : m_fileName (fileName),
+      m_append (append),
+      m_withId (withId),
+      m_head (0),
+      m_tail (0),
+      m_tailCache (0),
+      m_stop (false),
+      m_running (false),
+      m_fullWaits (0)
+    {
+      uint32_t size = 1;
+      while (size < capacity)
+        {
+          size <<= 1;
+        }
+      m_ring.resize (size);
+      m_mask = size - 1;
+      Registry &registry = GetRegistry ();
+      std::lock_guard<std::mutex> lock (registry.mutex);
+      registry.writers.insert (this);
+    }
+
+  ~AsyncTraceWriter ()
+    {
+      {
+        Registry &registry = GetRegistry ();
+        std::lock_guard<std::mutex> lock (registry.mutex);
+        registry.writers.erase (this);
+      }
+      Stop ();
+    }
+
+  /**
+   * \brief Queue a record (simulation thread); waits if the ring is full
+   * \param r the record
+   */
+  void Push (const Record &r)
+    {
+      if (!m_running)
+        {
+          Start ();
+        }
+      uint64_t head = m_head.load (std::memory_order_relaxed);
+      while (head - m_tailCache > m_mask)
+        {
+          m_tailCache = m_tail.load (std::memory_order_acquire);       //read the writer's position only when the cached one says full
+          if (head - m_tailCache > m_mask)
+            {
+              ++m_fullWaits;
+              std::this_thread::yield ();
+            }
+        }
+      m_ring[head & m_mask] = r;
+      m_head.store (head + 1, std::memory_order_release);
+    }
+
+  /**
+   * \brief Write the queued records, close the file and stop the thread (before fork, and at the end); the next
+   *        record restarts it, appending to the file
+   */
+  void Stop (void)
+    {
+      if (!m_running)
+        {
+          return;
+        }
+      m_stop.store (true, std::memory_order_release);
+      m_thread.join ();
+      m_running = false;
+      m_append = true;
+    }
+
+  /**
+   * \brief Continue the trace into another file (e.g. in a forked variant)
+   * \param fileName the trace file
+   * \param append append to the file instead of truncating it
+   */
+  void Reopen (std::string fileName, bool append = false)
+    {
+      Stop ();
+      m_fileName = fileName;
+      m_append = append;
+    }
+
+  /**
+   * \brief Stop every live writer of the process (called before fork by the pthread_atfork handler, from the forking
+   *        thread, which is the simulation thread of the writers that are pushed to)
+   */
+  static void StopAll (void)
+    {
+      Registry &registry = GetRegistry ();
+      std::lock_guard<std::mutex> lock (registry.mutex);
+      for (AsyncTraceWriter *writer : registry.writers)
+        {
+          writer->Stop ();
+        }
+    }
+
+  /**
+   * \brief Get the writer of a file shared by all its sources, appending to it; it is created at the first request and
+   *        destroyed (its records written) with its last owner
+   * \param fileName the trace file
+   * \param capacity records in the ring, if the writer is created
+   * \returns the writer of the file
+   */
+  static std::shared_ptr<AsyncTraceWriter> GetShared (const std::string &fileName, uint32_t capacity = 65536)
+    {
+      Registry &registry = GetRegistry ();
+      {
+        std::lock_guard<std::mutex> lock (registry.mutex);
+        std::shared_ptr<AsyncTraceWriter> writer = registry.shared[fileName].lock ();
+        if (writer)
+          {
+            return writer;
+          }
+      }
+      std::shared_ptr<AsyncTraceWriter> writer = std::make_shared<AsyncTraceWriter> (fileName, true, false, capacity);   //registers itself
+      std::lock_guard<std::mutex> lock (registry.mutex);
+      registry.shared[fileName] = writer;
+      return writer;
+    }
+
+  /// \returns the trace file
+  const std::string &GetFileName (void) const
+    {
+      return m_fileName;
+    }
+
+  /// \returns the times a record waited for room in the ring
+  uint64_t GetFullWaits (void) const
+    {
+      return m_fullWaits;
+    }
+
+private:
+  /// Live writers of the process
+  struct Registry
+  {
+    Registry ()
+    {
+      pthread_atfork (&AsyncTraceWriter::StopAll, 0, 0);
+    }
+
+    std::mutex mutex;                                   //!< guards writers
+    std::set<AsyncTraceWriter *> writers;               //!< writers constructed and not destroyed
+    std::map<std::string, std::weak_ptr<AsyncTraceWriter> > shared;   //!< shared writer of each file (GetShared)
+  };
+
+  static Registry &GetRegistry (void)
+    {
+      static Registry registry;                         //the fork handler is registered with the first writer
+      return registry;
+    }
+
+  void Start (void)
+    {
+      m_stop.store (false, std::memory_order_relaxed);
+      m_thread = std::thread (&AsyncTraceWriter::Run, this);
+      m_running = true;
+    }
+
+  //writer thread: format and write the records until stopped and the ring is empty
+  void Run (void)
+    {
+      std::ofstream stream (m_fileName.c_str (), m_append ? std::ios::app : std::ios::trunc);
+      uint64_t tail = m_tail.load (std::memory_order_relaxed);
+      while (true)
+        {
+          uint64_t head = m_head.load (std::memory_order_acquire);
+          if (head == tail)
+            {
+              if (m_stop.load (std::memory_order_acquire))
+                {
+                  if (m_head.load (std::memory_order_acquire) == tail)
+                    {
+                      break;
+                    }
+                  continue;
+                }
+              std::this_thread::sleep_for (std::chrono::microseconds (500));
+              continue;
+            }
+          for (; tail != head; ++tail)
+            {
+              Write (stream, m_ring[tail & m_mask]);
+            }
+          m_tail.store (tail, std::memory_order_release);
+        }
+    }
+
+  void Write (std::ofstream &stream, const Record &r) const
+    {
+      if (m_withId)
+        {
+          stream << r.id << "\t";
+        }
+      stream << r.time;
+      for (uint32_t i = 0; i < r.nValues; ++i)
+        {
+          stream << "\t";
+          if (r.intMask & (1 << i))
+            {
+              stream << static_cast<uint32_t> (r.values[i]);
+            }
+          else
+            {
+              stream << r.values[i];
+            }
+        }
+      stream << "\n";
+    }
+
+  std::string m_fileName;                               //!< trace file
+  bool m_append;                                        //!< open the file in append mode
+  bool m_withId;                                        //!< lines start with the record id
+  std::vector<Record> m_ring;                           //!< the records, m_mask + 1 of them
+  uint64_t m_mask;                                      //!< ring size - 1
+  alignas (64) std::atomic<uint64_t> m_head;            //!< records pushed (simulation thread)
+  alignas (64) std::atomic<uint64_t> m_tail;            //!< records written (writer thread)
+  uint64_t m_tailCache;                                 //!< last m_tail read by the simulation thread
+  alignas (64) std::atomic<bool> m_stop;                //!< writer thread to stop once the ring is empty
+  std::thread m_thread;                                 //!< writer thread
+  bool m_running;                                       //!< writer thread started
+  uint64_t m_fullWaits;                                 //!< waits for room in the ring
+};
+
+} // namespace ns3
+
+#endif /* ASYNC_TRACE_WRITER_H */
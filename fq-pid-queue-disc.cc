@@ -0,0 +1,475 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) October 2021 : R. Olusegun Alli-Oke
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: R. Olusegun Alli-Oke <razkgb2012@gmail.com>, <razak.alli-oke@elizadeuniversity.edu.ng>
+ */
+
+#include "fq-pid-queue-disc.h"
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "ns3/uinteger.h"
+#include "ns3/double.h"
+#include "ns3/boolean.h"
+#include "ns3/simulator.h"
+#include "ns3/drop-tail-queue.h"
+
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("FqPidQueueDisc");
+
+NS_OBJECT_ENSURE_REGISTERED (FqPidQueueDisc);
+
+TypeId FqPidQueueDisc::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::FqPidQueueDisc")
+    .SetParent<QueueDisc> ()
+    .SetGroupName ("TrafficControl")
+    .AddConstructor<FqPidQueueDisc> ()
+    .AddAttribute ("Flows",
+                   "The number of flow queues (preallocated)",
+                   UintegerValue (1024),
+                   MakeUintegerAccessor (&FqPidQueueDisc::m_flows),
+                   MakeUintegerChecker<uint32_t> (1, 1u << 24))
+    .AddAttribute ("Quantum",
+                   "The DRR quantum (bytes)",
+                   UintegerValue (1514),
+                   MakeUintegerAccessor (&FqPidQueueDisc::m_quantum),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("Perturbation",
+                   "The salt used as an additional input to the hash function used to classify packets",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&FqPidQueueDisc::m_perturbation),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("MaxSize",
+                   "The maximum number of packets accepted by this queue disc",
+                   QueueSizeValue (QueueSize ("10240p")),
+                   MakeQueueSizeAccessor (&QueueDisc::SetMaxSize,
+                                          &QueueDisc::GetMaxSize),
+                   MakeQueueSizeChecker ())
+    .AddAttribute ("PerFlowController",
+                   "One controller per flow queue, on the backlog of the queue, instead of one on the total backlog",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&FqPidQueueDisc::m_perFlowController),
+                   MakeBooleanChecker ())
+    .AddAttribute ("QueueSizeReference",
+                   "Desired queue size: total, or per flow queue with PerFlowController",
+                   QueueSizeValue (QueueSize ("1p")),
+                   MakeQueueSizeAccessor (&FqPidQueueDisc::m_QsizeRef),
+                   MakeQueueSizeChecker ())
+    .AddAttribute ("Supdate",
+                   "Start time to calculate drop probability",
+                   TimeValue (Seconds (0.0)),
+                   MakeTimeAccessor (&FqPidQueueDisc::m_sUpdate),
+                   MakeTimeChecker ())
+    .AddAttribute ("Tupdate",
+                   "Time period to calculate drop probability",
+                   TimeValue (Seconds (0.0)),
+                   MakeTimeAccessor (&FqPidQueueDisc::m_tUpdate),
+                   MakeTimeChecker ())
+    .AddAttribute ("a",
+                   "Value of a",
+                   DoubleValue (1.0),
+                   MakeDoubleAccessor (&FqPidQueueDisc::m_a),
+                   MakeDoubleChecker<double> ())
+    .AddAttribute ("b",
+                   "Value of b",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&FqPidQueueDisc::m_b),
+                   MakeDoubleChecker<double> ())
+    .AddAttribute ("c",
+                   "Value of c",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&FqPidQueueDisc::m_c),
+                   MakeDoubleChecker<double> ())
+    .AddAttribute ("d",
+                   "Value of d",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&FqPidQueueDisc::m_d),
+                   MakeDoubleChecker<double> ())
+    .AddAttribute ("e",
+                   "Value of e",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&FqPidQueueDisc::m_e),
+                   MakeDoubleChecker<double> ())
+    .AddAttribute ("u0",
+                   "Value of u0",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&FqPidQueueDisc::m_u0),
+                   MakeDoubleChecker<double> ())
+    .AddAttribute ("AntiWindup",
+                   "Store the saturated drop probability in the controller history",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&FqPidQueueDisc::m_antiWindup),
+                   MakeBooleanChecker ())
+    .AddAttribute ("WarmStart",
+                   "Drop with probability u0 from the start (and from the first packet of a flow with PerFlowController)",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&FqPidQueueDisc::m_warmStart),
+                   MakeBooleanChecker ())
+  ;
+  return tid;
+}
+
+FqPidQueueDisc::FqPidQueueDisc ()
+  : QueueDisc (QueueDiscSizePolicy::MULTIPLE_QUEUES, QueueSizeUnit::PACKETS),
+    m_tableMask (0),
+    m_nActiveFlows (0),
+    m_active (false)
+{
+  NS_LOG_FUNCTION (this);
+  m_uv = CreateObject<UniformRandomVariable> ();
+  m_newFlows.head = m_newFlows.tail = NO_QUEUE;
+  m_oldFlows.head = m_oldFlows.tail = NO_QUEUE;
+}
+
+FqPidQueueDisc::~FqPidQueueDisc ()
+{
+  NS_LOG_FUNCTION (this);
+  m_updateEvent.Cancel ();
+}
+
+void
+FqPidQueueDisc::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_uv = 0;
+  m_updateEvent.Cancel ();
+  m_core.SetController (nullptr);
+  m_flowCores.clear ();
+  QueueDisc::DoDispose ();
+}
+
+uint32_t
+FqPidQueueDisc::GetNActiveFlows (void) const
+{
+  return m_nActiveFlows;
+}
+
+bool
+FqPidQueueDisc::CheckConfig (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (GetNQueueDiscClasses () > 0)
+    {
+      NS_LOG_ERROR ("FqPidQueueDisc cannot have classes");
+      return false;
+    }
+  if (GetNPacketFilters () > 0)
+    {
+      NS_LOG_ERROR ("FqPidQueueDisc cannot have packet filters (flows are identified by the packet hash)");
+      return false;
+    }
+  if (GetNInternalQueues () > 0)
+    {
+      NS_LOG_ERROR ("FqPidQueueDisc cannot have internal queues (one per flow queue is created)");
+      return false;
+    }
+  if (GetMaxSize ().GetUnit () != QueueSizeUnit::PACKETS)
+    {
+      NS_LOG_ERROR ("FqPidQueueDisc MaxSize must be in packets");
+      return false;
+    }
+
+  //every flow queue can hold the whole disc: the limit is enforced on the total
+  for (uint32_t i = 0; i < m_flows; i++)
+    {
+      AddInternalQueue (CreateObjectWithAttributes<DropTailQueue<QueueDiscItem> > ("MaxSize", QueueSizeValue (GetMaxSize ())));
+    }
+
+  std::vector<double> num = {m_c, m_d, m_e};
+  std::vector<double> den = {m_a, m_b};
+  m_core.SetController (CreateDiscreteController (num, den));
+  m_core.Configure (m_u0, m_antiWindup, false);
+  if (m_perFlowController)
+    {
+      m_flowCores.resize (m_flows);
+      for (PidAqmCore &core : m_flowCores)
+        {
+          core.SetController (CreateDiscreteController (num, den));
+          core.Configure (m_u0, m_antiWindup, false);
+        }
+    }
+  return true;
+}
+
+void
+FqPidQueueDisc::InitializeParams (void)
+{
+  NS_LOG_FUNCTION (this);
+  FlowQueue q = {0, 0, NO_QUEUE, INACTIVE};
+  m_queues.assign (m_flows, q);
+
+  uint32_t size = 1;
+  while (size < 2 * m_flows)
+    {
+      size <<= 1;                                       //load factor of the flow table at most 1/2
+    }
+  FlowSlot empty = {0, NO_QUEUE};
+  m_table.assign (size, empty);
+  m_tableMask = size - 1;
+  m_nActiveFlows = 0;
+
+  m_freeQueues.resize (m_flows);
+  for (uint32_t i = 0; i < m_flows; i++)
+    {
+      m_freeQueues[i] = m_flows - 1 - i;                //queue 0 is given first
+    }
+  m_newFlows.head = m_newFlows.tail = NO_QUEUE;
+  m_oldFlows.head = m_oldFlows.tail = NO_QUEUE;
+
+  double p0 = m_warmStart ? m_u0 : -1;                  //-1: no drop until the first update
+  m_core.Reset (p0);
+  m_core.SetReference (double (m_QsizeRef.GetValue ()));
+  for (PidAqmCore &core : m_flowCores)
+    {
+      core.Reset (p0);
+      core.SetReference (double (m_QsizeRef.GetValue ()));
+    }
+  m_active = false;
+}
+
+bool
+FqPidQueueDisc::DoEnqueue (Ptr<QueueDiscItem> item)
+{
+  NS_LOG_FUNCTION (this << item);
+  if (!m_active && m_tUpdate.IsStrictlyPositive ())
+    {
+      //first enqueue: the updates run at Supdate + k * Tupdate from the next one due
+      Time now = Simulator::Now ();
+      Time tick = m_sUpdate;
+      if (tick < now)
+        {
+          tick += m_tUpdate * ((now - tick).GetTimeStep () / m_tUpdate.GetTimeStep () + 1);
+        }
+      m_updateEvent = Simulator::Schedule (tick - now, &FqPidQueueDisc::CalculateP, this);
+    }
+  m_active = true;
+
+  uint32_t queue = GetFlowQueue (item->Hash (m_perturbation));
+  FlowQueue &fq = m_queues[queue];
+
+  PidAqmCore &core = m_perFlowController ? m_flowCores[queue] : m_core;
+  if (GetNPackets () >= GetMaxSize ().GetValue ())
+    {
+      DropBeforeEnqueue (item, FORCED_DROP);
+    }
+  else if (core.DropEarly ([this] () { return m_uv->GetValue (); }))
+    {
+      DropBeforeEnqueue (item, UNFORCED_DROP);
+    }
+  else if (GetInternalQueue (queue)->Enqueue (item))
+    {
+      if (fq.status == INACTIVE)
+        {
+          fq.deficit = m_quantum;
+          fq.status = NEW_FLOW;
+          PushBack (m_newFlows, queue);
+        }
+      return true;
+    }
+
+  if (fq.status == INACTIVE)
+    {
+      ReleaseFlowQueue (queue);                         //the first packet of the flow was dropped
+    }
+  return false;
+}
+
+Ptr<QueueDiscItem>
+FqPidQueueDisc::DoDequeue (void)
+{
+  NS_LOG_FUNCTION (this);
+  while (true)
+    {
+      bool isNew = m_newFlows.head != NO_QUEUE;
+      FlowList &list = isNew ? m_newFlows : m_oldFlows;
+      if (list.head == NO_QUEUE)
+        {
+          NS_LOG_LOGIC ("No flow found to dequeue a packet");
+          return 0;
+        }
+      uint32_t queue = list.head;
+      FlowQueue &fq = m_queues[queue];
+
+      if (fq.deficit <= 0)
+        {
+          fq.deficit += m_quantum;
+          PopFront (list);
+          fq.status = OLD_FLOW;
+          PushBack (m_oldFlows, queue);
+          continue;
+        }
+
+      Ptr<QueueDiscItem> item = GetInternalQueue (queue)->Dequeue ();
+      if (!item)
+        {
+          PopFront (list);
+          if (isNew && m_oldFlows.head != NO_QUEUE)
+            {
+              fq.status = OLD_FLOW;                     //as FQ-CoDel: an emptied new flow goes through the old list once
+              PushBack (m_oldFlows, queue);
+            }
+          else
+            {
+              fq.status = INACTIVE;
+              ReleaseFlowQueue (queue);
+            }
+          continue;
+        }
+
+      fq.deficit -= item->GetSize ();
+      return item;
+    }
+}
+
+void
+FqPidQueueDisc::CalculateP (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_updateEvent = Simulator::Schedule (m_tUpdate, &FqPidQueueDisc::CalculateP, this);
+  if (!m_perFlowController)
+    {
+      m_core.Update (double (GetNPackets ()));
+      return;
+    }
+  //only the queues in the round robin: the others are reset when given to a flow
+  for (uint32_t queue = m_newFlows.head; queue != NO_QUEUE; queue = m_queues[queue].next)
+    {
+      m_flowCores[queue].Update (double (GetInternalQueue (queue)->GetNPackets ()));
+    }
+  for (uint32_t queue = m_oldFlows.head; queue != NO_QUEUE; queue = m_queues[queue].next)
+    {
+      m_flowCores[queue].Update (double (GetInternalQueue (queue)->GetNPackets ()));
+    }
+}
+
+uint32_t
+FqPidQueueDisc::GetFlowQueue (uint32_t hash)
+{
+  uint32_t slot = hash & m_tableMask;
+  while (m_table[slot].queue != NO_QUEUE)
+    {
+      if (m_table[slot].hash == hash)
+        {
+          return m_table[slot].queue;
+        }
+      slot = (slot + 1) & m_tableMask;
+    }
+
+  if (m_freeQueues.empty ())
+    {
+      return hash % m_flows;                            //all queues in use (and in the round robin): share one, without an entry
+    }
+  uint32_t queue = m_freeQueues.back ();
+  m_freeQueues.pop_back ();
+  m_table[slot].hash = hash;
+  m_table[slot].queue = queue;
+  ++m_nActiveFlows;
+  m_queues[queue].hash = hash;
+  if (m_perFlowController)
+    {
+      m_flowCores[queue].Reset (m_warmStart ? m_u0 : -1);
+    }
+  NS_LOG_LOGIC ("Flow " << hash << " given queue " << queue);
+  return queue;
+}
+
+void
+FqPidQueueDisc::ReleaseFlowQueue (uint32_t queue)
+{
+  uint32_t slot = m_queues[queue].hash & m_tableMask;
+  while (m_table[slot].queue != queue)
+    {
+      NS_ASSERT (m_table[slot].queue != NO_QUEUE);
+      slot = (slot + 1) & m_tableMask;
+    }
+
+  //backward-shift deletion: move back the entries of the probe sequence that would no longer be reachable
+  uint32_t next = slot;
+  while (true)
+    {
+      next = (next + 1) & m_tableMask;
+      if (m_table[next].queue == NO_QUEUE)
+        {
+          break;
+        }
+      uint32_t home = m_table[next].hash & m_tableMask;
+      bool reachable = (slot <= next) ? (slot < home && home <= next) : (slot < home || home <= next);
+      if (!reachable)
+        {
+          m_table[slot] = m_table[next];
+          slot = next;
+        }
+    }
+  m_table[slot].queue = NO_QUEUE;
+  --m_nActiveFlows;
+  m_freeQueues.push_back (queue);
+  NS_ASSERT_MSG (CheckFlowTable (), "Flow table inconsistent after releasing queue " << queue);
+  NS_LOG_LOGIC ("Queue " << queue << " released");
+}
+
+bool
+FqPidQueueDisc::CheckFlowTable (void) const
+{
+  uint32_t occupied = 0;
+  for (uint32_t slot = 0; slot <= m_tableMask; ++slot)
+    {
+      if (m_table[slot].queue == NO_QUEUE)
+        {
+          continue;
+        }
+      ++occupied;
+      if (m_queues[m_table[slot].queue].hash != m_table[slot].hash)
+        {
+          return false;
+        }
+      for (uint32_t probe = m_table[slot].hash & m_tableMask; probe != slot; probe = (probe + 1) & m_tableMask)
+        {
+          if (m_table[probe].queue == NO_QUEUE)
+            {
+              return false;                             //lookups of this flow would stop at the empty slot
+            }
+        }
+    }
+  return occupied == m_nActiveFlows && m_nActiveFlows + m_freeQueues.size () == m_flows;
+}
+
+void
+FqPidQueueDisc::PushBack (FlowList &list, uint32_t queue)
+{
+  m_queues[queue].next = NO_QUEUE;
+  if (list.head == NO_QUEUE)
+    {
+      list.head = queue;
+    }
+  else
+    {
+      m_queues[list.tail].next = queue;
+    }
+  list.tail = queue;
+}
+
+uint32_t
+FqPidQueueDisc::PopFront (FlowList &list)
+{
+  uint32_t queue = list.head;
+  list.head = m_queues[queue].next;
+  return queue;
+}
+
+} // namespace ns3
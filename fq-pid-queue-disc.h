@@ -0,0 +1,201 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) October 2021 : R. Olusegun Alli-Oke
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: R. Olusegun Alli-Oke <razkgb2012@gmail.com>, <razak.alli-oke@elizadeuniversity.edu.ng>
+ */
+
+
+#ifndef FQ_PID_QUEUE_DISC_H
+#define FQ_PID_QUEUE_DISC_H
+
+#include "ns3/queue-disc.h"
+#include "ns3/nstime.h"
+#include "ns3/event-id.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/pid-aqm-core.h"
+#include <stdint.h>
+#include <vector>
+
+
+namespace ns3 {
+
+/**
+ * \ingroup traffic-control
+ *
+ * \brief Flow-queued PID AQM (FQ-PID): per-flow queues served by deficit round robin, as FqCoDelQueueDisc, with the
+ *        drop probability computed by the PID controller of PidQueueDisc either on the aggregate backlog or per flow
+ *        queue.
+ *
+ * Flows are identified by the packet hash and mapped to one of Flows preallocated queues through an open-addressing
+ * flow table (linear probing, backward-shift deletion, twice as many slots as queues), so that distinct flows get
+ * distinct queues and the classification of a packet is O(1) at any number of flows. A queue is given to a flow at
+ * its first packet and released when the flow leaves the round robin (its queue is empty); when all the queues are
+ * in use, a new flow shares the queue at its hash modulo Flows. The new and old flow lists of the round robin are
+ * linked by queue index (no allocation per packet).
+ *
+ * With PerFlowController, every flow queue has its own controller, regulating its backlog to QueueSizeReference and
+ * started from the initial drop probability when the queue is given to a flow; otherwise one controller regulates
+ * the total backlog. Packets over MaxSize are dropped on arrival.
+ */
+class FqPidQueueDisc : public QueueDisc
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  /**
+   * \brief FqPidQueueDisc Constructor
+   */
+  FqPidQueueDisc ();
+
+  /**
+   * \brief FqPidQueueDisc Destructor
+   */
+  virtual ~FqPidQueueDisc ();
+
+  /**
+   * \brief Get the number of flows currently mapped to a queue
+   * \returns the number of flow table entries
+   */
+  uint32_t GetNActiveFlows (void) const;
+
+   // Reasons for dropping packets
+  static constexpr const char* UNFORCED_DROP = "Unforced drop";  //!< Early probability drops: proactive
+  static constexpr const char* FORCED_DROP = "Forced drop";      //!< Drops due to queue limit: reactive
+
+protected:
+  /**
+   * \brief Dispose of the object
+   */
+  virtual void DoDispose (void);
+
+private:
+  static const uint32_t NO_QUEUE = 0xffffffff;                 //!< empty flow table slot, end of a flow list
+
+  /// Round-robin state of a flow queue
+  enum FlowStatus
+  {
+    INACTIVE,     //!< free, or given to a flow that has no packet queued
+    NEW_FLOW,     //!< in the new flows list
+    OLD_FLOW      //!< in the old flows list
+  };
+
+  /// Flow queue
+  struct FlowQueue
+  {
+    uint32_t hash;                                             //!< hash of the flow using the queue
+    int32_t deficit;                                           //!< DRR deficit (bytes)
+    uint32_t next;                                             //!< next queue of the flow list
+    FlowStatus status;                                         //!< round-robin state
+  };
+
+  /// Flow table slot
+  struct FlowSlot
+  {
+    uint32_t hash;                                             //!< flow hash
+    uint32_t queue;                                            //!< queue of the flow, NO_QUEUE if the slot is empty
+  };
+
+  /// Singly-linked list of flow queues
+  struct FlowList
+  {
+    uint32_t head;                                             //!< first queue, NO_QUEUE if empty
+    uint32_t tail;                                             //!< last queue
+  };
+
+  // ** Variables supplied by user
+  uint32_t m_flows;                                            //!< number of flow queues
+  uint32_t m_quantum;                                          //!< DRR quantum (bytes)
+  uint32_t m_perturbation;                                     //!< hash perturbation value
+  bool m_perFlowController;                                    //!< one controller per flow queue instead of one on the aggregate
+  Time m_sUpdate;                                              //!< start time of the drop probability updates
+  Time m_tUpdate;                                              //!< drop probability update period
+  QueueSize m_QsizeRef;                                        //!< reference queue size (total, or per flow queue)
+  double m_a;                                                  //!< a parameter to PID difference-equation controller
+  double m_b;                                                  //!< b parameter to PID difference-equation controller
+  double m_c;                                                  //!< c parameter to PID difference-equation controller
+  double m_d;                                                  //!< d parameter to PID difference-equation controller
+  double m_e;                                                  //!< e parameter to PID difference-equation controller
+  double m_u0;                                                 //!< Linearization equilbrium packet-loss ratio
+  bool m_antiWindup;                                           //!< store the saturated drop probability in the controller history
+  bool m_warmStart;                                            //!< start from u0 instead of with no drop
+
+  // ** Variables maintained by FQ-PID
+  std::vector<FlowQueue> m_queues;                             //!< flow queues (their packets are in the internal queue of the same index)
+  std::vector<FlowSlot> m_table;                               //!< flow table, open addressing (power-of-2 size)
+  uint32_t m_tableMask;                                        //!< flow table size - 1
+  uint32_t m_nActiveFlows;                                     //!< occupied flow table slots
+  std::vector<uint32_t> m_freeQueues;                          //!< queues not given to a flow (stack)
+  FlowList m_newFlows;                                         //!< new flows list of the round robin
+  FlowList m_oldFlows;                                         //!< old flows list of the round robin
+  PidAqmCore m_core;                                           //!< aggregate controller
+  std::vector<PidAqmCore> m_flowCores;                         //!< per-flow-queue controllers (PerFlowController)
+  bool m_active;                                               //!< controller events scheduled (at the first enqueue)
+  EventId m_updateEvent;                                       //!< next drop probability update
+  Ptr<UniformRandomVariable> m_uv;                             //!< Rng stream, random variable for comparison with computed drop probability
+
+  virtual bool CheckConfig (void);
+  virtual void InitializeParams (void);
+  virtual bool DoEnqueue (Ptr<QueueDiscItem> item);
+  virtual Ptr<QueueDiscItem> DoDequeue (void);
+
+  /**
+   * \brief Periodic update of the drop probability (of every flow queue in the round robin with PerFlowController)
+   */
+  void CalculateP (void);
+
+  /**
+   * \brief Find the queue of a flow, giving it a queue if it has none
+   * \param hash flow hash
+   * \returns the queue index
+   */
+  uint32_t GetFlowQueue (uint32_t hash);
+
+  /**
+   * \brief Release the queue of a flow that left the round robin, and delete its flow table entry
+   * \param queue the queue index
+   */
+  void ReleaseFlowQueue (uint32_t queue);
+
+  /**
+   * \brief Check the flow table invariants (for NS_ASSERT): every entry is reachable from its home slot without
+   * crossing an empty slot, and every queue is either free or given to exactly one entry
+   * \returns true if the flow table is consistent
+   */
+  bool CheckFlowTable (void) const;
+
+  /**
+   * \brief Append a queue to a flow list
+   * \param list the list
+   * \param queue the queue index
+   */
+  void PushBack (FlowList &list, uint32_t queue);
+
+  /**
+   * \brief Remove the first queue of a flow list
+   * \param list the list (not empty)
+   * \returns the queue index
+   */
+  uint32_t PopFront (FlowList &list);
+};
+
+} // namespace ns3
+
+#endif /* FQ_PID_QUEUE_DISC_H */
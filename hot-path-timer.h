@@ -0,0 +1,269 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) October 2021 : R. Olusegun Alli-Oke
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: R. Olusegun Alli-Oke <razkgb2012@gmail.com>, <razak.alli-oke@elizadeuniversity.edu.ng>
+ */
+
+// Per-callsite hot-path timers. PID_HOTPATH_TIMER ("name") at the top of a function times the rest of its scope with
+// the time-stamp counter (steady_clock off x86) into per-thread counters of that call site: calls, total, min, max and a
+// log2 histogram of the cycles. Times are inclusive (a timed function called from another is also counted in the
+// caller). The report (calls, mean, percentiles from the histogram, in cycles and ns) is printed at Simulator::Destroy.
+//
+// Compiled out unless PID_HOTPATH_TIMING is defined, e.g.  CXXFLAGS="-DPID_HOTPATH_TIMING" ./waf configure ...
+// In core (header only, simulator.h is its only ns-3 dependency) so that internet (TcpTxBuffer) can use it.
+
+
+#ifndef HOT_PATH_TIMER_H
+#define HOT_PATH_TIMER_H
+
+#ifdef PID_HOTPATH_TIMING
+
+#include "ns3/simulator.h"
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+
+namespace ns3 {
+
+/**
+ * \ingroup core
+ *
+ * \brief Counters of the hot-path timers: call sites, per-thread counters and the report
+ */
+class HotPathTiming
+{
+public:
+  static const uint32_t BUCKETS = 65;                   //!< log2 histogram buckets: bucket b > 0 counts [2^(b-1), 2^b) cycles
+
+  /// Counters of one call site in one thread
+  struct Counters
+  {
+    uint64_t calls = 0;                                 //!< timed calls
+    uint64_t total = 0;                                 //!< sum of the cycles
+    uint64_t min = UINT64_MAX;                          //!< fewest cycles
+    uint64_t max = 0;                                   //!< most cycles
+    uint64_t hist[BUCKETS] = {};                        //!< log2 histogram of the cycles
+  };
+
+  static uint64_t Now (void)
+    {
+#if defined(__x86_64__) || defined(__i386__)
+      return __rdtsc ();
+#else
+      return std::chrono::duration_cast<std::chrono::nanoseconds> (std::chrono::steady_clock::now ().time_since_epoch ()).count ();
+#endif
+    }
+
+  /**
+   * \brief Register a call site
+   * \param name the name of the call site
+   * \returns the id of the call site
+   */
+  static uint32_t AddSite (const char *name)
+    {
+      HotPathTiming &t = Get ();
+      std::lock_guard<std::mutex> lock (t.m_mutex);
+      t.m_names.push_back (name);
+      return t.m_names.size () - 1;
+    }
+
+  /**
+   * \brief Count one timed call
+   * \param site the id of the call site
+   * \param cycles the cycles spent
+   */
+  static void Add (uint32_t site, uint64_t cycles)
+    {
+      thread_local std::vector<Counters> *counters = Get ().AddThread ();
+      if (site >= counters->size ())
+        {
+          std::lock_guard<std::mutex> lock (Get ().m_mutex);   //the report may be reading the vector
+          counters->resize (site + 1);
+        }
+      Counters &c = (*counters)[site];
+      ++c.calls;
+      c.total += cycles;
+      c.min = std::min (c.min, cycles);
+      c.max = std::max (c.max, cycles);
+      ++c.hist[cycles == 0 ? 0 : 64 - __builtin_clzll (cycles)];
+    }
+
+  /**
+   * \brief Schedule the report at Simulator::Destroy, once per simulation
+   */
+  static void ScheduleReport (void)
+    {
+      HotPathTiming &t = Get ();
+      if (!t.m_scheduled.load (std::memory_order_relaxed) && !t.m_scheduled.exchange (true))
+        {
+          t.m_tsc0 = Now ();
+          t.m_clock0 = std::chrono::steady_clock::now ();
+          Simulator::ScheduleDestroy (&HotPathTiming::Report);
+        }
+    }
+
+  /**
+   * \brief Print the counters of all the call sites (summed over the threads) and clear them
+   */
+  static void Report (void)
+    {
+      HotPathTiming &t = Get ();
+      std::lock_guard<std::mutex> lock (t.m_mutex);
+      double secs = std::chrono::duration<double> (std::chrono::steady_clock::now () - t.m_clock0).count ();
+      double nsPerCycle = (secs > 0 && Now () > t.m_tsc0) ? secs * 1e9 / (Now () - t.m_tsc0) : 1;
+
+      std::cout << "\nhot-path timers (cycles; ns at " << 1 / nsPerCycle << " cycles/ns)" << std::endl;
+      std::cout << std::left << std::setw (36) << "call site" << std::right << std::setw (12) << "calls" << std::setw (10) << "mean"
+                << std::setw (10) << "min" << std::setw (10) << "p50" << std::setw (10) << "p90" << std::setw (10) << "p99"
+                << std::setw (12) << "max" << std::setw (12) << "mean(ns)" << std::setw (12) << "total(s)" << std::endl;
+      for (uint32_t s = 0; s < t.m_names.size (); ++s)
+        {
+          Counters sum;
+          for (std::vector<Counters> *counters : t.m_threads)
+            {
+              if (s >= counters->size ())
+                {
+                  continue;
+                }
+              const Counters &c = (*counters)[s];
+              sum.calls += c.calls;
+              sum.total += c.total;
+              sum.min = std::min (sum.min, c.min);
+              sum.max = std::max (sum.max, c.max);
+              for (uint32_t b = 0; b < BUCKETS; ++b)
+                {
+                  sum.hist[b] += c.hist[b];
+                }
+              (*counters)[s] = Counters ();
+            }
+          if (sum.calls == 0)
+            {
+              continue;
+            }
+          double mean = double (sum.total) / sum.calls;
+          std::cout << std::left << std::setw (36) << t.m_names[s] << std::right << std::setw (12) << sum.calls << std::setw (10) << uint64_t (mean)
+                    << std::setw (10) << sum.min << std::setw (10) << Percentile (sum, 0.5) << std::setw (10) << Percentile (sum, 0.9)
+                    << std::setw (10) << Percentile (sum, 0.99) << std::setw (12) << sum.max << std::setw (12) << mean * nsPerCycle
+                    << std::setw (12) << sum.total * nsPerCycle * 1e-9 << std::endl;
+          std::cout << "    histogram (<2^b cycles: calls)";
+          for (uint32_t b = 0; b < BUCKETS; ++b)
+            {
+              if (sum.hist[b] > 0)
+                {
+                  std::cout << "  " << b << ":" << sum.hist[b];
+                }
+            }
+          std::cout << std::endl;
+        }
+      std::cout << std::endl;
+      t.m_scheduled = false;
+    }
+
+private:
+  HotPathTiming () : m_scheduled (false), m_tsc0 (0) {}
+
+  static HotPathTiming &Get (void)
+    {
+      static HotPathTiming *t = new HotPathTiming;      //never destroyed: the thread counters may outlive static destruction
+      return *t;
+    }
+
+  std::vector<Counters> *AddThread (void)
+    {
+      std::lock_guard<std::mutex> lock (m_mutex);
+      m_threads.push_back (new std::vector<Counters> (m_names.size ()));
+      return m_threads.back ();
+    }
+
+  /**
+   * \brief Upper bound of the bucket holding a percentile
+   * \param c the counters
+   * \param q the quantile
+   * \returns the cycles
+   */
+  static uint64_t Percentile (const Counters &c, double q)
+    {
+      uint64_t rank = static_cast<uint64_t> (q * (c.calls - 1)) + 1, seen = 0;
+      for (uint32_t b = 0; b < BUCKETS; ++b)
+        {
+          seen += c.hist[b];
+          if (seen >= rank)
+            {
+              return std::min (c.max, (b == 0) ? uint64_t (0) : (b >= 64 ? UINT64_MAX : (uint64_t (1) << b) - 1));
+            }
+        }
+      return c.max;
+    }
+
+  std::mutex m_mutex;                                   //!< protects the call sites and the thread list
+  std::vector<std::string> m_names;                     //!< call site names, by id
+  std::vector<std::vector<Counters> *> m_threads;       //!< counters of each thread, by call site id
+  std::atomic<bool> m_scheduled;                        //!< report scheduled for the current simulation
+  uint64_t m_tsc0;                                      //!< counter at the first timed call, for the ns conversion
+  std::chrono::steady_clock::time_point m_clock0;       //!< clock at the first timed call
+};
+
+/**
+ * \ingroup core
+ *
+ * \brief Times its scope into the counters of a call site
+ */
+class HotPathScopedTimer
+{
+public:
+  explicit HotPathScopedTimer (uint32_t site)
+    : m_site (site)
+    {
+      HotPathTiming::ScheduleReport ();
+      m_start = HotPathTiming::Now ();
+    }
+
+  ~HotPathScopedTimer ()
+    {
+      HotPathTiming::Add (m_site, HotPathTiming::Now () - m_start);
+    }
+
+private:
+  uint32_t m_site;                                      //!< call site id
+  uint64_t m_start;                                     //!< counter at the start of the scope
+};
+
+} // namespace ns3
+
+#define PID_HOTPATH_CONCAT2(a, b) a ## b
+#define PID_HOTPATH_CONCAT(a, b) PID_HOTPATH_CONCAT2 (a, b)
+#define PID_HOTPATH_TIMER(name) \
+  static const uint32_t PID_HOTPATH_CONCAT (pidHotPathSite, __LINE__) = ns3::HotPathTiming::AddSite (name); \
+  ns3::HotPathScopedTimer PID_HOTPATH_CONCAT (pidHotPathTimer, __LINE__) (PID_HOTPATH_CONCAT (pidHotPathSite, __LINE__))
+
+#else
+
+#define PID_HOTPATH_TIMER(name)
+
+#endif /* PID_HOTPATH_TIMING */
+
+#endif /* HOT_PATH_TIMER_H */
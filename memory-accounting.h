@@ -0,0 +1,96 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) October 2021 : R. Olusegun Alli-Oke
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: R. Olusegun Alli-Oke <razkgb2012@gmail.com>, <razak.alli-oke@elizadeuniversity.edu.ng>
+ */
+
+// Live-object counters of the objects that have no other way to be counted from outside their owner (the TcpTxItems
+// of the TcpTxBuffer lists). The owners count their allocations and deletions; pid-memory.h samples the counters,
+// with the objects that can be counted from outside (queue items, buffered bytes, sockets), during a run.
+// The counters are plain integers: one simulation per process (forked runs have their own copy).
+// In core (header only, no ns-3 dependency) so that internet (TcpTxBuffer) can use it.
+
+
+#ifndef MEMORY_ACCOUNTING_H
+#define MEMORY_ACCOUNTING_H
+
+#include <stdint.h>
+
+
+namespace ns3 {
+
+/**
+ * \ingroup core
+ *
+ * \brief Live-object counters
+ */
+class MemoryAccounting
+{
+public:
+  /// Counted object kinds
+  enum Kind
+  {
+    TCP_TX_ITEM,        //!< TcpTxItem of the sent and application lists of TcpTxBuffer
+    KINDS               //!< number of kinds
+  };
+
+  /// Counters of one kind
+  struct Counters
+  {
+    uint64_t live = 0;                                  //!< objects allocated and not deleted
+    uint64_t peak = 0;                                  //!< most live objects
+    uint64_t allocated = 0;                             //!< objects allocated
+  };
+
+  /**
+   * \brief Count an allocation
+   * \param kind the object kind
+   */
+  static void Allocated (Kind kind)
+    {
+      Counters &c = Get (kind);
+      ++c.allocated;
+      if (++c.live > c.peak)
+        {
+          c.peak = c.live;
+        }
+    }
+
+  /**
+   * \brief Count a deletion
+   * \param kind the object kind
+   */
+  static void Deleted (Kind kind)
+    {
+      --Get (kind).live;
+    }
+
+  /**
+   * \brief Get the counters of a kind
+   * \param kind the object kind
+   * \returns the counters
+   */
+  static Counters &Get (Kind kind)
+    {
+      static Counters counters[KINDS];
+      return counters[kind];
+    }
+};
+
+} // namespace ns3
+
+#endif /* MEMORY_ACCOUNTING_H */
@@ -0,0 +1,173 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) October 2021 : R. Olusegun Alli-Oke
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: R. Olusegun Alli-Oke <razkgb2012@gmail.com>, <razak.alli-oke@elizadeuniversity.edu.ng>
+ */
+
+#include "mq-pid-queue-disc.h"
+#include "pid-queue-disc.h"
+#include "ns3/log.h"
+#include "ns3/enum.h"
+#include "ns3/boolean.h"
+#include "ns3/string.h"
+#include "ns3/net-device-queue-interface.h"
+#include <sstream>
+
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("MqPidQueueDisc");
+
+NS_OBJECT_ENSURE_REGISTERED (MqPidQueueDisc);
+
+TypeId MqPidQueueDisc::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::MqPidQueueDisc")
+    .SetParent<QueueDisc> ()
+    .SetGroupName ("TrafficControl")
+    .AddConstructor<MqPidQueueDisc> ()
+    .AddAttribute ("SharedController",
+                   "Drive all the TX queues with one controller (that of the first child) on their aggregate backlog, "
+                   "instead of one controller per TX queue",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&MqPidQueueDisc::m_sharedController),
+                   MakeBooleanChecker ())
+  ;
+  return tid;
+}
+
+MqPidQueueDisc::MqPidQueueDisc ()
+  : QueueDisc (QueueDiscSizePolicy::NO_LIMITS)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+MqPidQueueDisc::~MqPidQueueDisc ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+MqPidQueueDisc::WakeMode
+MqPidQueueDisc::GetWakeMode (void) const
+{
+  return WAKE_CHILD;
+}
+
+bool
+MqPidQueueDisc::DoEnqueue (Ptr<QueueDiscItem> item)
+{
+  NS_LOG_FUNCTION (this << item);
+
+  uint32_t queueIndex = item->GetTxQueueIndex ();
+  NS_ASSERT (queueIndex < GetNQueueDiscClasses ());
+
+  bool retval = GetQueueDiscClass (queueIndex)->GetQueueDisc ()->Enqueue (item);
+
+  if (!retval)
+    {
+      NS_LOG_WARN ("Packet enqueue failed: check the size of the internal queues");
+    }
+
+  return retval;
+}
+
+Ptr<QueueDiscItem>
+MqPidQueueDisc::DoDequeue (void)
+{
+  NS_ASSERT_MSG (false, "MqPidQueueDisc: DoDequeue should not be called (the children are woken by their TX queue)");
+  return 0;
+}
+
+bool
+MqPidQueueDisc::CheckConfig (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  if (GetNPacketFilters () > 0)
+    {
+      NS_LOG_ERROR ("MqPidQueueDisc cannot have packet filters");
+      return false;
+    }
+  if (GetNInternalQueues () > 0)
+    {
+      NS_LOG_ERROR ("MqPidQueueDisc cannot have internal queues");
+      return false;
+    }
+  Ptr<NetDeviceQueueInterface> ndqi = GetNetDeviceQueueInterface ();
+  if (!ndqi)
+    {
+      NS_LOG_ERROR ("MqPidQueueDisc needs to be the root queue disc of a device");
+      return false;
+    }
+  if (GetNQueueDiscClasses () != ndqi->GetNTxQueues ())
+    {
+      NS_LOG_ERROR ("MqPidQueueDisc needs one class per device TX queue (" << ndqi->GetNTxQueues () << ")");
+      return false;
+    }
+
+  Ptr<PidQueueDisc> leader;
+  for (uint32_t i = 0; i < GetNQueueDiscClasses (); i++)
+    {
+      Ptr<PidQueueDisc> child = DynamicCast<PidQueueDisc> (GetQueueDiscClass (i)->GetQueueDisc ());
+      if (!child)
+        {
+          NS_LOG_ERROR ("The children of MqPidQueueDisc must be PidQueueDiscs");
+          return false;
+        }
+      //the children are initialized after this: their own backlog, and one trace file each
+      child->SetAttribute ("QueueSizeMeasurement", EnumValue (PidQueueDisc::MEASURE_DISC));
+      StringValue file;
+      child->GetAttribute ("DropProbTraceFile", file);
+      child->SetAttribute ("DropProbTraceFile", StringValue (ChildTraceFile (file.Get (), i)));
+      if (!m_sharedController)
+        {
+          continue;
+        }
+      if (!leader)
+        {
+          leader = child;
+        }
+      else
+        {
+          leader->AddFollower (child);
+        }
+    }
+
+  return true;
+}
+
+void
+MqPidQueueDisc::InitializeParams (void)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+std::string
+MqPidQueueDisc::ChildTraceFile (const std::string &file, uint32_t index)
+{
+  std::ostringstream oss;
+  oss << "-q" << index;
+  std::string::size_type slash = file.find_last_of ('/');
+  std::string::size_type dot = file.find_last_of ('.');
+  if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+    {
+      return file + oss.str ();
+    }
+  return file.substr (0, dot) + oss.str () + file.substr (dot);
+}
+
+} // namespace ns3
@@ -0,0 +1,94 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) October 2021 : R. Olusegun Alli-Oke
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: R. Olusegun Alli-Oke <razkgb2012@gmail.com>, <razak.alli-oke@elizadeuniversity.edu.ng>
+ */
+
+
+#ifndef MQ_PID_QUEUE_DISC_H
+#define MQ_PID_QUEUE_DISC_H
+
+#include "ns3/queue-disc.h"
+#include <string>
+
+
+namespace ns3 {
+
+/**
+ * \ingroup traffic-control
+ *
+ * \brief Multi-queue PID AQM: the root queue disc of a multi-queue device, with one PidQueueDisc (or
+ *        PidQueueDisc<Policy>) child per device TX queue, as MqQueueDisc. Packets are enqueued into the child of the TX
+ *        queue selected for them, and each child is dequeued when its TX queue is woken.
+ *
+ * Each child runs its own controller (CalculateP events, drop probability, PWM state) on its own backlog: the
+ * netdevice TX queues of a multi-queue device are not visible to the children, so their QueueSizeMeasurement is set
+ * to Disc. The children append their drop probability to their DropProbTraceFile with a "-q<index>" suffix. With
+ * SharedController, the controller of the first child is driven by the aggregate backlog of all the children and its
+ * drop probability is applied to all of them (see PidQueueDisc::AddFollower).
+ *
+ * The classes and children are added with the TrafficControlHelper, e.g. for a device with n TX queues:
+ *
+ *   uint16_t handle = tch.SetRootQueueDisc ("ns3::MqPidQueueDisc");
+ *   TrafficControlHelper::ClassIdList cid = tch.AddQueueDiscClasses (handle, n, "ns3::QueueDiscClass");
+ *   tch.AddChildQueueDiscs (handle, cid, "ns3::PidQueueDisc<PID>");
+ */
+class MqPidQueueDisc : public QueueDisc
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  /**
+   * \brief MqPidQueueDisc Constructor
+   */
+  MqPidQueueDisc ();
+
+  /**
+   * \brief MqPidQueueDisc Destructor
+   */
+  virtual ~MqPidQueueDisc ();
+
+  /**
+   * \brief The children are woken (and dequeued) by their own TX queue
+   * \return WAKE_CHILD
+   */
+  virtual WakeMode GetWakeMode (void) const;
+
+private:
+  bool m_sharedController;                                     //!< drive all the children with the controller of the first one
+
+  virtual bool DoEnqueue (Ptr<QueueDiscItem> item);
+  virtual Ptr<QueueDiscItem> DoDequeue (void);
+  virtual bool CheckConfig (void);
+  virtual void InitializeParams (void);
+
+  /**
+   * \brief Name of the drop probability trace file of a child
+   * \param file trace file of the child
+   * \param index TX queue of the child
+   * \returns the file name with "-q<index>" inserted before the extension
+   */
+  static std::string ChildTraceFile (const std::string &file, uint32_t index);
+};
+
+} // namespace ns3
+
+#endif /* MQ_PID_QUEUE_DISC_H */
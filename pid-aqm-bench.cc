@@ -0,0 +1,235 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) October 2021 : R. Olusegun Alli-Oke
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: R. Olusegun Alli-Oke <razkgb2012@gmail.com>, <razak.alli-oke@elizadeuniversity.edu.ng>
+ */
+
+// ===========================================================================
+//
+// Per-packet cost of the PID AQM core (pid-aqm-core.h) in a userspace packet loop, without ns-3.
+//
+// A producer thread pushes packet descriptors (virtual arrival time, size) into a single-producer single-consumer
+// lock-free ring; the consumer thread (the "data plane") pops them, runs the AQM (Poll + DropEarly) and enqueues the
+// accepted packets into a FIFO served at the link rate in virtual time. The arrivals are Poisson at load x link rate,
+// so that the controller is active (the Kahe2014 gains are designed for the TCP loop of pid-script.cc, so the queue is
+// not regulated at the reference here: only the cost is of interest). The loop is timed with and without the AQM (tail drop only); the difference is
+// the cost of the AQM per packet. The loop is also timed without the ring (data plane alone); the ring figures are only
+// meaningful if the producer runs on another core.
+//
+// Build (outside ns-3):  g++ -O2 -std=c++11 -pthread -I src/traffic-control/model pid-aqm-bench.cc -o pid-aqm-bench
+// Run:                   ./pid-aqm-bench [packets] [load]
+//
+// ===========================================================================
+
+
+#include "pid-aqm-core.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace ns3;
+
+struct PacketDesc
+{
+  int64_t tsNs;                 //arrival time (virtual, ns)
+  uint32_t size;                //bytes
+};
+
+//single-producer single-consumer ring; the capacity is a power of 2
+template <class T>
+class SpscRing
+{
+public:
+  explicit SpscRing (size_t capacity) : m_buf (capacity), m_mask (capacity - 1), m_head (0), m_tail (0) {}
+
+  bool TryPush (const T &v)
+  {
+    size_t tail = m_tail.load (std::memory_order_relaxed);
+    if (tail - m_head.load (std::memory_order_acquire) == m_buf.size ())
+      {
+        return false;
+      }
+    m_buf[tail & m_mask] = v;
+    m_tail.store (tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool TryPop (T &v)
+  {
+    size_t head = m_head.load (std::memory_order_relaxed);
+    if (head == m_tail.load (std::memory_order_acquire))
+      {
+        return false;
+      }
+    v = m_buf[head & m_mask];
+    m_head.store (head + 1, std::memory_order_release);
+    return true;
+  }
+
+private:
+  std::vector<T> m_buf;
+  size_t m_mask;
+  alignas (64) std::atomic<size_t> m_head;      //consumer index
+  alignas (64) std::atomic<size_t> m_tail;      //producer index
+};
+
+//xorshift64*: uniform in [0, 1)
+class FastUniform
+{
+public:
+  explicit FastUniform (uint64_t seed) : m_s (seed) {}
+  double operator() (void)
+  {
+    m_s ^= m_s >> 12; m_s ^= m_s << 25; m_s ^= m_s >> 27;
+    return ((m_s * 2685821657736338717ULL) >> 11) * (1.0 / 9007199254740992.0);
+  }
+private:
+  uint64_t m_s;
+};
+
+struct Result
+{
+  double nsPerPacket;
+  uint64_t dropped;
+  double meanQueue;
+};
+
+static Result
+RunLoop (uint64_t nPackets, double load, bool useAqm, bool useRing)
+{
+  const double linkBps = 15e6;                  //bottleneck of pid-script.cc
+  const uint32_t pktSize = 512;
+  const uint32_t limit = 800;
+  const int64_t txNs = static_cast<int64_t> ((pktSize + 2) * 8 / linkBps * 1e9);
+
+  //arrivals are generated beforehand, so that the producer (the "NIC") is not the bottleneck of the timed loop
+  std::vector<PacketDesc> arrivals (nPackets);
+  FastUniform ua (12345);
+  double t = 0, meanGap = txNs / load;
+  for (uint64_t i = 0; i < nPackets; ++i)
+    {
+      t += -meanGap * std::log (1 - ua ());
+      arrivals[i].tsNs = static_cast<int64_t> (t);
+      arrivals[i].size = pktSize;
+    }
+
+  SpscRing<PacketDesc> ring (4096);
+  std::atomic<bool> go (false);
+
+  std::thread producer ([&] ()
+    {
+      if (!useRing)
+        {
+          return;
+        }
+      while (!go.load (std::memory_order_acquire))
+        {
+          std::this_thread::yield ();
+        }
+      for (uint64_t i = 0; i < nPackets; ++i)
+        {
+          while (!ring.TryPush (arrivals[i]))
+            {
+              std::this_thread::yield ();
+            }
+        }
+    });
+
+  PidAqmCore core;
+  core.SetController (CreateDiscreteController ({-0.0002556, 0.0005043, -0.0002487}, {1.8290, -0.8290}));   //Kahe2014
+  core.Configure (0.0085, true, false);
+  core.Reset (0.0085);
+  core.SetReference (175);
+  core.StartSampling (0, 6250000);              //T = 6.25 ms
+  FastUniform u (67890);
+
+  std::vector<int64_t> fifo (limit);            //departure times of the queued packets
+  uint32_t fifoHead = 0, qlen = 0;
+  int64_t lastDeparture = 0;
+  uint64_t dropped = 0;
+  double qSum = 0;
+
+  auto start = std::chrono::steady_clock::now ();
+  go.store (true, std::memory_order_release);
+  PacketDesc p;
+  for (uint64_t i = 0; i < nPackets; ++i)
+    {
+      if (useRing)
+        {
+          while (!ring.TryPop (p))
+            {
+              std::this_thread::yield ();                       //only if the producer is slower (or shares the core)
+            }
+        }
+      else
+        {
+          p = arrivals[i];                                      //data plane alone, without the ring
+        }
+      while (qlen > 0 && fifo[fifoHead] <= p.tsNs)              //departures up to this arrival
+        {
+          fifoHead = (fifoHead + 1 == limit) ? 0 : fifoHead + 1;
+          --qlen;
+        }
+      qSum += qlen;
+      if (useAqm)
+        {
+          core.Poll (p.tsNs, qlen);
+        }
+      if (qlen == limit || (useAqm && core.DropEarly (u)))
+        {
+          ++dropped;
+          continue;
+        }
+      lastDeparture = std::max (lastDeparture, p.tsNs) + txNs;
+      uint32_t tail = fifoHead + qlen;
+      fifo[(tail >= limit) ? tail - limit : tail] = lastDeparture;
+      ++qlen;
+    }
+  auto stop = std::chrono::steady_clock::now ();
+  producer.join ();
+
+  Result r;
+  r.nsPerPacket = std::chrono::duration<double, std::nano> (stop - start).count () / nPackets;
+  r.dropped = dropped;
+  r.meanQueue = qSum / nPackets;
+  return r;
+}
+
+
+int main (int argc, char *argv[])
+{
+  uint64_t nPackets = (argc > 1) ? std::strtoull (argv[1], 0, 10) : 20000000;
+  double load = (argc > 2) ? std::atof (argv[2]) : 1.05;
+
+  std::cout << "packets: " << nPackets << "\tload: " << load << "\thardware threads: " << std::thread::hardware_concurrency () << std::endl;
+  for (int useRing = 0; useRing <= 1; ++useRing)
+    {
+      Result tail = RunLoop (nPackets, load, false, useRing);
+      Result aqm = RunLoop (nPackets, load, true, useRing);
+      std::cout << (useRing ? "\n[SPSC ring]" : "\n[no ring]") << std::endl;
+      std::cout << "tail drop:\t" << tail.nsPerPacket << " ns/packet\tdrop ratio " << double (tail.dropped) / nPackets << "\tmean queue " << tail.meanQueue << std::endl;
+      std::cout << "PID AQM:\t" << aqm.nsPerPacket << " ns/packet\tdrop ratio " << double (aqm.dropped) / nPackets << "\tmean queue " << aqm.meanQueue << std::endl;
+      std::cout << "AQM cost:\t" << aqm.nsPerPacket - tail.nsPerPacket << " ns/packet" << std::endl;
+    }
+  return 0;
+}
@@ -0,0 +1,286 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) October 2021 : R. Olusegun Alli-Oke
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: R. Olusegun Alli-Oke <razkgb2012@gmail.com>, <razak.alli-oke@elizadeuniversity.edu.ng>
+ */
+
+// Simulator-independent core of PidQueueDisc: controller update, saturation, anti-windup, drop decision (random or PWM)
+// and timestamp-driven sampling. PidQueueDisc wraps it (ns-3 events, queue sizes, rng stream); a userspace data plane
+// calls Poll () and DropEarly () on every arrival (see pid-aqm-bench.cc). Like pid-controller.h, this header has no
+// ns-3 dependency.
+
+
+#ifndef PID_AQM_CORE_H
+#define PID_AQM_CORE_H
+
+#include "pid-controller.h"
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+
+namespace ns3 {
+
+/**
+ * \ingroup traffic-control
+ *
+ * \brief Control law and drop decision of the PID AQM. The controller works on deviations from the linearization
+ *        equilibrium (du, dq); the drop probability is u0 + du, saturated to [0, 1].
+ */
+class PidAqmCore
+{
+public:
+  PidAqmCore ()
+    : m_u0 (0), m_antiWindup (false), m_usePwm (false), m_signalBits (0), m_ref (0),
+      m_periodNs (0), m_nextUpdateNs (0),
+      m_dropProb (-1), m_dropProb0 (0), m_err (0), m_pwmDuty (0), m_pwmPhase (0)
+    {
+    }
+
+  /**
+   * \brief Set the controller (the core takes ownership)
+   * \param controller the difference-equation controller
+   */
+  void SetController (std::unique_ptr<DiscreteController> controller)
+    {
+      m_controller = std::move (controller);
+    }
+
+  DiscreteController *GetController (void) const
+    {
+      return m_controller.get ();
+    }
+
+  /**
+   * \brief Set the operating point and the actuation
+   * \param u0 linearization equilibrium drop probability
+   * \param antiWindup store the saturated drop probability in the controller history
+   * \param usePwm drop deterministically with the duty cycle given by the drop probability
+   */
+  void Configure (double u0, bool antiWindup, bool usePwm)
+    {
+      m_u0 = u0;
+      m_antiWindup = antiWindup;
+      m_usePwm = usePwm;
+    }
+
+  /**
+   * \brief Fixed-point operation, with a FixedPointController: u0 is quantized to the Q(signalBits) grid of the
+   *        controller output, so that u0 + du and the saturation to [0, 1] are exact (integer) operations on that grid,
+   *        and DropEarlyRaw compares the drop probability in Q32 with raw random bits. Call after Configure.
+   * \param signalBits fractional bits of the controller signals, 0 for floating point
+   */
+  void SetFixedPoint (uint32_t signalBits)
+    {
+      m_signalBits = signalBits;
+      if (m_signalBits > 0)
+        {
+          m_u0 = FixedPointController::ToDouble (FixedPointController::ToFixed (m_u0, m_signalBits), m_signalBits);
+        }
+    }
+
+  /**
+   * \brief Clear the controller history and set the initial drop probability
+   * \param dropProb initial drop probability: u0 for a warm start, a negative value for no drop (open loop)
+   */
+  void Reset (double dropProb)
+    {
+      m_dropProb = dropProb;
+      m_dropProb0 = 0;
+      m_err = 0;
+      m_pwmDuty = (m_dropProb <= 0) ? 0 : m_dropProb;
+      m_pwmPhase = 0;
+      m_controller->Reset (0, 0);       //linearized controller: previous deviations are zero, also at the operating point
+    }
+
+  /**
+   * \brief Set the reference (queue size or delay, in the units of the measurement passed to Update and Poll)
+   * \param ref the reference
+   */
+  void SetReference (double ref)
+    {
+      m_ref = ref;
+    }
+
+  double GetReference (void) const
+    {
+      return m_ref;
+    }
+
+  /**
+   * \brief Controller tick: update the drop probability from a measurement of the controlled variable
+   * \param measurement queue size (or delay)
+   * \returns the saturated drop probability
+   */
+  double Update (double measurement)
+    {
+      m_err = m_ref - measurement;
+      m_dropProb0 = m_u0 + m_controller->Update (m_err);                   //unsaturated: u0 is added after the controller
+      double p = (m_dropProb0 <= 0) ? 0 : m_dropProb0;
+      m_dropProb = (p <= 1) ? p : 1;                                         //saturation comes after adding u0
+      if (m_antiWindup)
+        {
+          m_controller->Saturate (m_dropProb - m_u0);
+        }
+      LatchPwm ();
+      return m_dropProb;
+    }
+
+  /**
+   * \brief Impose a drop probability computed elsewhere (e.g. by a controller shared by several queues) in place of
+   *        a tick of this core; the controller history is left untouched
+   * \param dropProb the saturated drop probability
+   */
+  void SetDropProb (double dropProb)
+    {
+      m_dropProb0 = dropProb;
+      m_dropProb = dropProb;
+      LatchPwm ();
+    }
+
+  /**
+   * \brief Start timestamp-driven sampling: Poll runs a controller tick at start + k * period
+   * \param startNs time of the first tick (ns)
+   * \param periodNs sampling period (ns)
+   */
+  void StartSampling (int64_t startNs, int64_t periodNs)
+    {
+      m_nextUpdateNs = startNs;
+      m_periodNs = periodNs;
+    }
+
+  /**
+   * \brief Run the controller ticks that are due at the given time (for a data plane without timers). Ticks missed
+   *        while there were no arrivals are run with the current measurement, as a timer-driven controller would.
+   * \param nowNs current time (ns)
+   * \param measurement queue size (or delay)
+   * \returns the number of ticks run
+   */
+  uint32_t Poll (int64_t nowNs, double measurement)
+    {
+      uint32_t n = 0;
+      while (m_periodNs > 0 && nowNs >= m_nextUpdateNs)
+        {
+          Update (measurement);
+          m_nextUpdateNs += m_periodNs;
+          ++n;
+        }
+      return n;
+    }
+
+  /**
+   * \brief Early (unforced) drop decision for an arrival
+   * \param uniform callable returning a uniform random value in [0, 1); not called with PWM actuation
+   * \param scale factor applied to the drop probability (or the PWM duty cycle) for this packet, e.g. its size over
+   *        the mean packet size in byte mode
+   * \returns true if the packet is to be dropped (or marked); with PWM, at most one drop per arrival
+   */
+  template <class Uniform>
+  bool DropEarly (Uniform &&uniform, double scale = 1)
+    {
+      if (m_usePwm)
+        {
+          //PWM: no rng, the phase advances by the duty cycle on every arrival and a packet is dropped each time it wraps.
+          //One arrival is dropped at most once: the whole wraps are discarded with the drop (the fraction is carried), so
+          //a scaled duty above 1 (byte mode) leaves no debt of drops to be paid in a burst after the duty falls
+          m_pwmPhase += m_pwmDuty * scale;
+          if (m_pwmPhase < 1)
+            {
+              return false;
+            }
+          m_pwmPhase -= std::floor (m_pwmPhase);
+          return true;
+        }
+      return !(m_dropProb * scale < uniform ());                              //open loop (m_dropProb = -1) never drops
+    }
+
+  /**
+   * \brief Early (unforced) drop decision with integer arithmetic only: the drop probability, in Q32 (exact for a
+   *        fixed-point core with up to 32 signal bits), is compared with 32 raw random bits
+   * \param bits callable returning 32 uniformly distributed random bits; not called with PWM actuation
+   * \param scaleNum numerator of the factor applied to the drop probability (e.g. the packet size in byte mode)
+   * \param scaleDen denominator of the factor (e.g. the mean packet size)
+   * \returns true if the packet is to be dropped (or marked)
+   */
+  template <class RawBits>
+  bool DropEarlyRaw (RawBits &&bits, uint32_t scaleNum = 1, uint32_t scaleDen = 1)
+    {
+      if (m_usePwm)
+        {
+          return DropEarly ([] () { return 0.0; }, double (scaleNum) / scaleDen);
+        }
+      if (m_dropProb <= 0)
+        {
+          return false;                                                       //open loop, or no drop
+        }
+      uint64_t threshold = static_cast<uint64_t> (std::ldexp (m_dropProb, 32));   //p in Q32: a shift of the exponent
+      threshold = threshold * scaleNum / scaleDen;
+      return static_cast<uint64_t> (static_cast<uint32_t> (bits ())) < threshold;
+    }
+
+  double GetDropProb (void) const
+    {
+      return m_dropProb;
+    }
+
+  double GetUnsaturatedDropProb (void) const
+    {
+      return m_dropProb0;
+    }
+
+  double GetError (void) const
+    {
+      return m_err;
+    }
+
+  double GetPwmPhase (void) const
+    {
+      return m_pwmPhase;
+    }
+
+private:
+  void LatchPwm (void)
+    {
+      if (m_usePwm)
+        {
+          m_pwmDuty = m_dropProb;
+          if (m_pwmDuty == 0)
+            {
+              m_pwmPhase = 0;                                                //no pending (fractional) drop is carried over an off period
+            }
+        }
+    }
+
+  std::unique_ptr<DiscreteController> m_controller;     //!< difference-equation controller
+  double m_u0;                          //!< linearization equilibrium drop probability
+  bool m_antiWindup;                    //!< store the saturated drop probability in the controller history
+  bool m_usePwm;                        //!< pulse-width-modulated actuation
+  uint32_t m_signalBits;                //!< fractional bits of the fixed-point signals, 0 for floating point
+  double m_ref;                         //!< reference of the controlled variable
+  int64_t m_periodNs;                   //!< sampling period of Poll (ns), 0 if not sampling
+  int64_t m_nextUpdateNs;               //!< time of the next tick of Poll (ns)
+  double m_dropProb;                    //!< saturated drop probability
+  double m_dropProb0;                   //!< unsaturated drop probability
+  double m_err;                         //!< error of the last tick
+  double m_pwmDuty;                     //!< PWM duty cycle latched at the last tick
+  double m_pwmPhase;                    //!< PWM phase accumulator: a packet is dropped each time it reaches 1
+};
+
+} // namespace ns3
+
+#endif /* PID_AQM_CORE_H */
@@ -0,0 +1,112 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) October 2021 : R. Olusegun Alli-Oke
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: R. Olusegun Alli-Oke <razkgb2012@gmail.com>, <razak.alli-oke@elizadeuniversity.edu.ng>
+ */
+
+// Recording of the packet arrivals at the bottleneck queue disc (pid-script.cc) and their replay (pid-replay.cc).
+// Records are fixed-size binary: arrival time (ns), packet size (bytes) and flow id (5-tuple hash).
+
+
+#ifndef PID_ARRIVALS_H
+#define PID_ARRIVALS_H
+
+#include "ns3/core-module.h"
+#include "ns3/traffic-control-module.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+struct ArrivalRecord
+{
+  int64_t timeNs;               //arrival time at the queue disc
+  uint32_t size;                //packet size (bytes, IP packet)
+  uint32_t flowId;              //flow id (hash of the 5-tuple)
+};
+
+//trace-sink for the "Arrival" trace source of PidQueueDisc; records are buffered and written in blocks
+class ArrivalRecorder
+{
+public:
+  ArrivalRecorder (std::string fileName, uint32_t bufRecords = 65536)
+    : m_file (std::fopen (fileName.c_str (), "wb")), m_buf (bufRecords), m_nRecords (0)
+  {
+    NS_ABORT_MSG_UNLESS (m_file, "cannot open " << fileName);
+  }
+
+  ~ArrivalRecorder ()
+  {
+    Close ();
+  }
+
+  static void Record (ArrivalRecorder *recorder, Ptr<const QueueDiscItem> item)
+  {
+    ArrivalRecord &r = recorder->m_buf[recorder->m_nRecords];
+    r.timeNs = Simulator::Now ().GetNanoSeconds ();
+    r.size = item->GetSize ();
+    r.flowId = item->Hash (0);
+    if (++recorder->m_nRecords == recorder->m_buf.size ()) { recorder->Flush (); }
+  }
+
+  void Flush (void)
+  {
+    if (m_file && m_nRecords > 0)
+      {
+        std::fwrite (&m_buf[0], sizeof (ArrivalRecord), m_nRecords, m_file);
+      }
+    m_nRecords = 0;
+  }
+
+  void Close (void)
+  {
+    Flush ();
+    if (m_file)
+      {
+        std::fclose (m_file);
+        m_file = 0;
+      }
+  }
+
+private:
+  std::FILE *m_file;
+  std::vector<ArrivalRecord> m_buf;
+  uint32_t m_nRecords;
+};
+
+//read all records of an arrival file
+inline std::vector<ArrivalRecord>
+ReadArrivals (std::string fileName)
+{
+  std::vector<ArrivalRecord> records;
+  std::FILE *file = std::fopen (fileName.c_str (), "rb");
+  NS_ABORT_MSG_UNLESS (file, "cannot open " << fileName);
+  ArrivalRecord buf[4096];
+  size_t n;
+  while ((n = std::fread (buf, sizeof (ArrivalRecord), 4096, file)) > 0)
+    {
+      records.insert (records.end (), buf, buf + n);
+    }
+  std::fclose (file);
+  return records;
+}
+
+} // namespace ns3
+
+#endif /* PID_ARRIVALS_H */
@@ -0,0 +1,611 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) October 2021 : R. Olusegun Alli-Oke
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: R. Olusegun Alli-Oke <razkgb2012@gmail.com>, <razak.alli-oke@elizadeuniversity.edu.ng>
+ */
+
+// Discrete-time (IIR) controllers used by PidQueueDisc. The difference equation is
+//
+//      u_k  =  den[0] * u_{k-1} + ... + den[m-1] * u_{k-m}  +  num[0] * e_k + num[1] * e_{k-1} + ... + num[n-1] * e_{k-n+1}
+//
+// so that the 2nd-order PID of pid-script.cc is num = {c, d, e} and den = {a, b}, a PI (Hollot2002, Ustebay2007) is
+// num = {c, d} and den = {1}, and a PD (P-Pina 2016) is num = {c, d} and den = {}. This header has no ns-3 dependency.
+
+
+#ifndef PID_CONTROLLER_H
+#define PID_CONTROLLER_H
+
+#include <array>
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+
+
+namespace ns3 {
+
+/**
+ * \ingroup traffic-control
+ *
+ * \brief Interface of a discrete (IIR) controller. u and e are deviations from the linearization equilibrium (du, dq).
+ */
+class DiscreteController
+{
+public:
+  virtual ~DiscreteController () {}
+
+  /**
+   * \brief Compute the (unsaturated) output and shift the histories
+   * \param err current error e_k
+   * \returns u_k
+   */
+  virtual double Update (double err) = 0;
+
+  /**
+   * \brief Anti-windup: overwrite the latest stored output u_k with its saturated value
+   * \param u saturated u_k
+   */
+  virtual void Saturate (double u) = 0;
+
+  /**
+   * \brief Fill the output and error histories with constant values
+   * \param u value of u_{k-1}, u_{k-2}, ...
+   * \param err value of e_{k-1}, e_{k-2}, ...
+   */
+  virtual void Reset (double u, double err) = 0;
+
+  /**
+   * \brief Replace the coefficients, keeping the histories (orders must not change)
+   * \param num numerator coefficients (error terms)
+   * \param den denominator coefficients (output terms)
+   * \returns false if the orders do not match
+   */
+  virtual bool SetCoefficients (const std::vector<double> &num, const std::vector<double> &den) = 0;
+};
+
+
+/**
+ * \ingroup traffic-control
+ *
+ * \brief Fixed-order controller: histories are shifted std::arrays so that the update is unrolled and branch-free
+ */
+template <std::size_t NNUM, std::size_t NDEN>
+class FixedOrderController : public DiscreteController
+{
+public:
+  FixedOrderController (const std::vector<double> &num, const std::vector<double> &den)
+    {
+      SetCoefficients (num, den);
+      Reset (0, 0);
+    }
+
+  virtual double Update (double err)
+    {
+      for (std::size_t i = NNUM - 1; i > 0; --i)
+        {
+          m_err[i] = m_err[i - 1];
+        }
+      m_err[0] = err;
+
+      double u = 0;
+      for (std::size_t i = 0; i < NDEN; ++i)
+        {
+          u += m_den[i] * m_out[i];
+        }
+      for (std::size_t i = 0; i < NNUM; ++i)
+        {
+          u += m_num[i] * m_err[i];
+        }
+
+      for (std::size_t i = NDEN; i > 1; --i)
+        {
+          m_out[i - 1] = m_out[i - 2];
+        }
+      if (NDEN > 0)
+        {
+          m_out[0] = u;
+        }
+      return u;
+    }
+
+  virtual void Saturate (double u)
+    {
+      if (NDEN > 0)
+        {
+          m_out[0] = u;
+        }
+    }
+
+  virtual void Reset (double u, double err)
+    {
+      m_out.fill (u);
+      m_err.fill (err);
+    }
+
+  virtual bool SetCoefficients (const std::vector<double> &num, const std::vector<double> &den)
+    {
+      if (num.size () != NNUM || den.size () != NDEN)
+        {
+          return false;
+        }
+      for (std::size_t i = 0; i < NNUM; ++i)
+        {
+          m_num[i] = num[i];
+        }
+      for (std::size_t i = 0; i < NDEN; ++i)
+        {
+          m_den[i] = den[i];
+        }
+      return true;
+    }
+
+private:
+  std::array<double, NNUM> m_num;       //!< error coefficients, num[j] multiplies e_{k-j}
+  std::array<double, NDEN> m_den;       //!< output coefficients, den[i] multiplies u_{k-1-i}
+  std::array<double, NNUM> m_err;       //!< e_k, e_{k-1}, ... (e_{k-1}, e_{k-2}, ... before Update)
+  std::array<double, NDEN> m_out;       //!< u_{k-1}, u_{k-2}, ... (u_k, u_{k-1}, ... after Update)
+};
+
+
+/**
+ * \ingroup traffic-control
+ *
+ * \brief Arbitrary-order controller: coefficients as vectors, histories in ring buffers
+ */
+class VariableOrderController : public DiscreteController
+{
+public:
+  VariableOrderController (const std::vector<double> &num, const std::vector<double> &den)
+    : m_num (num),
+      m_den (den),
+      m_err (num.size (), 0),
+      m_out (den.size (), 0),
+      m_errHead (0),
+      m_outHead (0)
+    {
+    }
+
+  virtual double Update (double err)
+    {
+      const std::size_t nn = m_num.size ();
+      const std::size_t nd = m_den.size ();
+
+      if (nn > 0)
+        {
+          m_errHead = (m_errHead == 0) ? nn - 1 : m_errHead - 1;    // m_err[m_errHead] is e_k
+          m_err[m_errHead] = err;
+        }
+
+      double u = 0;
+      for (std::size_t i = 0, j = m_outHead; i < nd; ++i, j = (j + 1 == nd) ? 0 : j + 1)
+        {
+          u += m_den[i] * m_out[j];
+        }
+      for (std::size_t i = 0, j = m_errHead; i < nn; ++i, j = (j + 1 == nn) ? 0 : j + 1)
+        {
+          u += m_num[i] * m_err[j];
+        }
+
+      if (nd > 0)
+        {
+          m_outHead = (m_outHead == 0) ? nd - 1 : m_outHead - 1;    // m_out[m_outHead] is u_k
+          m_out[m_outHead] = u;
+        }
+      return u;
+    }
+
+  virtual void Saturate (double u)
+    {
+      if (!m_out.empty ())
+        {
+          m_out[m_outHead] = u;
+        }
+    }
+
+  virtual void Reset (double u, double err)
+    {
+      m_out.assign (m_den.size (), u);
+      m_err.assign (m_num.size (), err);
+      m_errHead = 0;
+      m_outHead = 0;
+    }
+
+  virtual bool SetCoefficients (const std::vector<double> &num, const std::vector<double> &den)
+    {
+      if (num.size () != m_num.size () || den.size () != m_den.size ())
+        {
+          return false;
+        }
+      m_num = num;
+      m_den = den;
+      return true;
+    }
+
+private:
+  std::vector<double> m_num;            //!< error coefficients, num[j] multiplies e_{k-j}
+  std::vector<double> m_den;            //!< output coefficients, den[i] multiplies u_{k-1-i}
+  std::vector<double> m_err;            //!< ring buffer of errors
+  std::vector<double> m_out;            //!< ring buffer of outputs
+  std::size_t m_errHead;                //!< index of the most recent error
+  std::size_t m_outHead;                //!< index of the most recent output
+};
+
+
+/**
+ * \ingroup traffic-control
+ *
+ * \brief Fixed-point (integer) controller of arbitrary order, for data planes without floating point (switch and NIC
+ *        pipelines). Coefficients are quantized to Q(coefBits) and the signals (errors and outputs) to Q(signalBits),
+ *        held in int64 with saturating arithmetic; the products are accumulated in Q(coefBits + signalBits) and rounded
+ *        back to Q(signalBits). The conversions to and from double are at the interface only: the output is a multiple
+ *        of 2^-signalBits, exactly representable as a double.
+ */
+class FixedPointController : public DiscreteController
+{
+public:
+  FixedPointController (const std::vector<double> &num, const std::vector<double> &den, uint32_t coefBits, uint32_t signalBits)
+    : m_coefBits (coefBits),
+      m_signalBits (signalBits),
+      m_num (num.size ()),
+      m_den (den.size ())
+    {
+      SetCoefficients (num, den);
+      Reset (0, 0);
+    }
+
+  /**
+   * \brief Check a Q-format: the fractional bits of the coefficients and of the signals must leave the products an
+   *        integer bit
+   * \param coefBits fractional bits of the coefficients
+   * \param signalBits fractional bits of the signals
+   * \returns true if the format is supported
+   */
+  static bool Accepts (uint32_t coefBits, uint32_t signalBits)
+    {
+      return coefBits >= 1 && signalBits >= 1 && coefBits + signalBits <= 62;
+    }
+
+  /**
+   * \brief Quantize to Q(bits): round to nearest, saturate to the int64 range
+   * \param x the value
+   * \param bits fractional bits
+   * \returns the fixed-point value
+   */
+  static int64_t ToFixed (double x, uint32_t bits)
+    {
+      double q = std::round (std::ldexp (x, bits));
+      if (!(q > -9.2e18))
+        {
+          return (q != q) ? 0 : INT64_MIN;
+        }
+      return (q < 9.2e18) ? static_cast<int64_t> (q) : INT64_MAX;
+    }
+
+  static double ToDouble (int64_t q, uint32_t bits)
+    {
+      return std::ldexp (static_cast<double> (q), -static_cast<int> (bits));
+    }
+
+  virtual double Update (double err)
+    {
+      for (std::size_t i = m_err.size (); i > 1; --i)
+        {
+          m_err[i - 1] = m_err[i - 2];
+        }
+      if (!m_err.empty ())
+        {
+          m_err[0] = ToFixed (err, m_signalBits);
+        }
+
+      int64_t acc = 0;                                  //Q(coefBits + signalBits)
+      for (std::size_t i = 0; i < m_den.size (); ++i)
+        {
+          acc = SatAdd (acc, SatMul (m_den[i], m_out[i]));
+        }
+      for (std::size_t i = 0; i < m_num.size (); ++i)
+        {
+          acc = SatAdd (acc, SatMul (m_num[i], m_err[i]));
+        }
+      int64_t u = SatAdd (acc, int64_t (1) << (m_coefBits - 1)) >> m_coefBits;   //round to Q(signalBits)
+
+      for (std::size_t i = m_out.size (); i > 1; --i)
+        {
+          m_out[i - 1] = m_out[i - 2];
+        }
+      if (!m_out.empty ())
+        {
+          m_out[0] = u;
+        }
+      return ToDouble (u, m_signalBits);
+    }
+
+  virtual void Saturate (double u)
+    {
+      if (!m_out.empty ())
+        {
+          m_out[0] = ToFixed (u, m_signalBits);
+        }
+    }
+
+  virtual void Reset (double u, double err)
+    {
+      m_out.assign (m_den.size (), ToFixed (u, m_signalBits));
+      m_err.assign (m_num.size (), ToFixed (err, m_signalBits));
+    }
+
+  virtual bool SetCoefficients (const std::vector<double> &num, const std::vector<double> &den)
+    {
+      if (num.size () != m_num.size () || den.size () != m_den.size ())
+        {
+          return false;
+        }
+      for (std::size_t i = 0; i < num.size (); ++i)
+        {
+          m_num[i] = ToFixed (num[i], m_coefBits);
+        }
+      for (std::size_t i = 0; i < den.size (); ++i)
+        {
+          m_den[i] = ToFixed (den[i], m_coefBits);
+        }
+      return true;
+    }
+
+  /**
+   * \brief Get the quantized coefficients (e.g. to report their quantization error)
+   * \param num numerator coefficients
+   * \param den denominator coefficients
+   */
+  void GetCoefficients (std::vector<double> &num, std::vector<double> &den) const
+    {
+      num.clear ();
+      den.clear ();
+      for (int64_t q : m_num)
+        {
+          num.push_back (ToDouble (q, m_coefBits));
+        }
+      for (int64_t q : m_den)
+        {
+          den.push_back (ToDouble (q, m_coefBits));
+        }
+    }
+
+private:
+  static int64_t SatAdd (int64_t a, int64_t b)
+    {
+      int64_t r;
+      if (__builtin_add_overflow (a, b, &r))
+        {
+          return (b > 0) ? INT64_MAX : INT64_MIN;
+        }
+      return r;
+    }
+
+  static int64_t SatMul (int64_t a, int64_t b)
+    {
+      int64_t r;
+      if (__builtin_mul_overflow (a, b, &r))
+        {
+          return ((a < 0) != (b < 0)) ? INT64_MIN : INT64_MAX;
+        }
+      return r;
+    }
+
+  uint32_t m_coefBits;                  //!< fractional bits of the coefficients
+  uint32_t m_signalBits;                //!< fractional bits of the errors and outputs
+  std::vector<int64_t> m_num;           //!< error coefficients, num[j] multiplies e_{k-j}
+  std::vector<int64_t> m_den;           //!< output coefficients, den[i] multiplies u_{k-1-i}
+  std::vector<int64_t> m_err;           //!< e_k, e_{k-1}, ... (e_{k-1}, e_{k-2}, ... before Update)
+  std::vector<int64_t> m_out;           //!< u_{k-1}, u_{k-2}, ... (u_k, u_{k-1}, ... after Update)
+};
+
+
+/**
+ * \ingroup traffic-control
+ *
+ * \brief Controller policies: which terms of  u_k = a u_{k-1} + b u_{k-2} + c e_k + d e_{k-1} + e e_{k-2}  are present.
+ *        Absent terms are removed at compile time by PolicyController.
+ */
+struct PiPolicy
+{
+  static const char *GetName (void) { return "PI"; }
+  enum { A = 1, B = 0, D = 1, E = 0 };                  //!< uk = a u_{k-1} + c e_k + d e_{k-1}   (Hollot2002, Ustebay2007)
+};
+
+struct PdPolicy
+{
+  static const char *GetName (void) { return "PD"; }
+  enum { A = 0, B = 0, D = 1, E = 0 };                  //!< uk = c e_k + d e_{k-1}   (P-Pina 2016)
+};
+
+struct PidPolicy
+{
+  static const char *GetName (void) { return "PID"; }
+  enum { A = 1, B = 1, D = 1, E = 1 };                  //!< uk = a u_{k-1} + b u_{k-2} + c e_k + d e_{k-1} + e e_{k-2}   (Ge2010, Kahe2014)
+};
+
+struct GenericPolicy
+{
+  static const char *GetName (void) { return "Generic"; }   //!< arbitrary order, see CreateDiscreteController
+};
+
+
+/**
+ * \ingroup traffic-control
+ *
+ * \brief 2nd-order difference equation restricted to the terms of a controller policy
+ */
+template <class Policy>
+class PolicyController : public DiscreteController
+{
+public:
+  PolicyController (const std::vector<double> &num, const std::vector<double> &den)
+    {
+      SetCoefficients (num, den);
+      Reset (0, 0);
+    }
+
+  /**
+   * \brief Check that the coefficients fit the policy, i.e. that no dropped term has a non-zero coefficient
+   * \param num numerator coefficients {c, d, e}
+   * \param den denominator coefficients {a, b}
+   * \returns true if the coefficients fit
+   */
+  static bool Accepts (const std::vector<double> &num, const std::vector<double> &den)
+    {
+      if (num.size () > 3 || den.size () > 2)
+        {
+          return false;
+        }
+      const bool keep[5] = {bool (Policy::A), bool (Policy::B), true, bool (Policy::D), bool (Policy::E)};
+      for (std::size_t i = 0; i < den.size (); ++i)
+        {
+          if (!keep[i] && den[i] != 0)
+            {
+              return false;
+            }
+        }
+      for (std::size_t i = 0; i < num.size (); ++i)
+        {
+          if (!keep[2 + i] && num[i] != 0)
+            {
+              return false;
+            }
+        }
+      return true;
+    }
+
+  virtual double Update (double err)
+    {
+      double u = 0;             //summed in the order of the baseline a*u1 + b*u2 + c*e + d*e1 + e*e2 (bit-identical results)
+      if (Policy::A)
+        {
+          u += m_a * m_u1;
+        }
+      if (Policy::B)
+        {
+          u += m_b * m_u2;
+        }
+      u += m_c * err;
+      if (Policy::D)
+        {
+          u += m_d * m_e1;
+        }
+      if (Policy::E)
+        {
+          u += m_e * m_e2;
+          m_e2 = m_e1;
+        }
+      if (Policy::D || Policy::E)
+        {
+          m_e1 = err;
+        }
+      if (Policy::B)
+        {
+          m_u2 = m_u1;
+        }
+      if (Policy::A || Policy::B)
+        {
+          m_u1 = u;
+        }
+      return u;
+    }
+
+  virtual void Saturate (double u)
+    {
+      m_u1 = u;
+    }
+
+  virtual void Reset (double u, double err)
+    {
+      m_u1 = m_u2 = u;
+      m_e1 = m_e2 = err;
+    }
+
+  virtual bool SetCoefficients (const std::vector<double> &num, const std::vector<double> &den)
+    {
+      if (!Accepts (num, den))
+        {
+          return false;
+        }
+      m_a = den.size () > 0 ? den[0] : 0;
+      m_b = den.size () > 1 ? den[1] : 0;
+      m_c = num.size () > 0 ? num[0] : 0;
+      m_d = num.size () > 1 ? num[1] : 0;
+      m_e = num.size () > 2 ? num[2] : 0;
+      return true;
+    }
+
+private:
+  double m_a, m_b, m_c, m_d, m_e;       //!< coefficients of the difference equation
+  double m_u1, m_u2;                    //!< u_{k-1}, u_{k-2}
+  double m_e1, m_e2;                    //!< e_{k-1}, e_{k-2}
+};
+
+
+/**
+ * \brief Create a controller for the given coefficients, using a fixed-order specialization for the common orders
+ *        (P, PI, PD, PID and the 2nd-order Kahe/Ge designs) and the ring-buffered one otherwise.
+ * \param num numerator coefficients (error terms)
+ * \param den denominator coefficients (output terms)
+ * \returns the controller
+ */
+inline std::unique_ptr<DiscreteController>
+CreateDiscreteController (const std::vector<double> &num, const std::vector<double> &den)
+{
+  DiscreteController *ctrl;
+  std::size_t order = (num.size () < 10 && den.size () < 10) ? num.size () * 10 + den.size () : 0;
+  switch (order)
+    {
+      case 10: ctrl = new FixedOrderController<1, 0> (num, den); break;      // P
+      case 20: ctrl = new FixedOrderController<2, 0> (num, den); break;      // PD
+      case 21: ctrl = new FixedOrderController<2, 1> (num, den); break;      // PI
+      case 31: ctrl = new FixedOrderController<3, 1> (num, den); break;      // PID (ideal)
+      case 32: ctrl = new FixedOrderController<3, 2> (num, den); break;      // PID (filtered), equation 15
+      default: ctrl = new VariableOrderController (num, den); break;
+    }
+  return std::unique_ptr<DiscreteController> (ctrl);
+}
+
+
+/**
+ * \brief Create the controller of a policy
+ * \param num numerator coefficients {c, d, e}
+ * \param den denominator coefficients {a, b}
+ * \returns the controller, or a null pointer if the coefficients do not fit the policy
+ */
+template <class Policy>
+std::unique_ptr<DiscreteController>
+CreatePolicyController (const std::vector<double> &num, const std::vector<double> &den)
+{
+  if (!PolicyController<Policy>::Accepts (num, den))
+    {
+      return std::unique_ptr<DiscreteController> ();
+    }
+  return std::unique_ptr<DiscreteController> (new PolicyController<Policy> (num, den));
+}
+
+template <>
+inline std::unique_ptr<DiscreteController>
+CreatePolicyController<GenericPolicy> (const std::vector<double> &num, const std::vector<double> &den)
+{
+  return CreateDiscreteController (num, den);
+}
+
+} // namespace ns3
+
+#endif /* PID_CONTROLLER_H */
@@ -0,0 +1,200 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) October 2021 : R. Olusegun Alli-Oke
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: R. Olusegun Alli-Oke <razkgb2012@gmail.com>, <razak.alli-oke@elizadeuniversity.edu.ng>
+ */
+
+// The pid-script.cc workload (TCP NewReno bulk flows over a dumbbell with a PidQueueDisc bottleneck, same defaults),
+// parameterized by the number of flows, for the benchmark programs. Several flows may share a leaf node, so that
+// large flow counts do not need as many nodes; the leaf links are addressed as /30 subnets (up to 16384 leaves per side).
+
+
+#ifndef PID_DUMBBELL_H
+#define PID_DUMBBELL_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/traffic-control-module.h"
+
+#include <algorithm>
+#include <string>
+
+namespace ns3 {
+
+struct DumbbellConfig
+{
+  uint32_t nFlows = 60;                         //TCP flows (one BulkSend source per flow)
+  uint32_t maxLeaves = 600;                     //leaves per side; flows are spread over min(nFlows, maxLeaves) leaves
+  bool scaleRate = true;                        //scale the bottleneck rate with nFlows / 60, keeping the per-flow share of pid-script.cc
+  std::string bottleneckRate = "15Mbps";        //for 60 flows
+  std::string bottleneckDelay = "98ms";
+  std::string leafRate = "30Mbps";
+  std::string leafDelay = "1ms";
+  uint32_t tcpMSSize = 500;
+  uint32_t maxQueuePackets = 800;               //netdevice queues
+  uint32_t qDiscLimitPkts = 800;
+  uint32_t QsizeRefPktsEQ = 175;
+  uint32_t QsizeRefPktsDQ = 475;
+  std::string qDiscType = "ns3::PidQueueDisc<PID>";
+  bool useBql = false;                          //dynamic queue limits on the bottleneck TxQueue: the backlog sits in the queue disc
+  double cstart = 1;                            //source start (s)
+  double cstop = 21;                            //source stop (s)
+};
+
+struct Dumbbell
+{
+  NodeContainer left, routers, right;
+  Ptr<NetDevice> bottleneckDevice;              //LeftRouterR
+  Ptr<QueueDisc> bottleneckQueueDisc;
+  ApplicationContainer sources, sinks;
+};
+
+/**
+ * \brief Set the TCP and PidQueueDisc defaults of pid-script.cc (Kahe2014 PID, T = 6.25 ms, closed loop from cstart,
+ *        step at cstart + 80 s). Call before BuildDumbbell.
+ */
+inline void
+SetPidScriptDefaults (const DumbbellConfig &cfg)
+{
+  Config::SetDefault ("ns3::TcpSocketBase::Sack", BooleanValue (false));
+  Config::SetDefault ("ns3::TcpSocket::DelAckCount", UintegerValue (0));
+  Config::SetDefault ("ns3::TcpL4Protocol::SocketType", StringValue ("ns3::TcpNewReno"));
+  Config::SetDefault ("ns3::TcpSocketBase::WindowScaling", BooleanValue (false));
+  Config::SetDefault ("ns3::TcpSocket::RcvBufSize", UintegerValue (65535));
+  Config::SetDefault ("ns3::TcpSocketBase::MaxWindowSize", UintegerValue (65535));
+  Config::SetDefault ("ns3::TcpSocket::InitialCwnd", UintegerValue (1));
+  Config::SetDefault ("ns3::TcpSocket::SegmentSize", UintegerValue (cfg.tcpMSSize));
+
+  Config::SetDefault ("ns3::QueueBase::MaxSize", QueueSizeValue (QueueSize (QueueSizeUnit::PACKETS, cfg.maxQueuePackets)));
+  Config::SetDefault ("ns3::PidQueueDisc::MaxSize", QueueSizeValue (QueueSize (QueueSizeUnit::PACKETS, cfg.qDiscLimitPkts)));
+  Config::SetDefault ("ns3::PidQueueDisc::QueueSizeReferenceEQ", QueueSizeValue (QueueSize (QueueSizeUnit::PACKETS, cfg.QsizeRefPktsEQ)));
+  Config::SetDefault ("ns3::PidQueueDisc::QueueSizeReferenceDQ", QueueSizeValue (QueueSize (QueueSizeUnit::PACKETS, cfg.QsizeRefPktsDQ)));
+  Config::SetDefault ("ns3::PidQueueDisc::a", DoubleValue (1.8290));
+  Config::SetDefault ("ns3::PidQueueDisc::b", DoubleValue (-0.8290));
+  Config::SetDefault ("ns3::PidQueueDisc::c", DoubleValue (-0.0002556));
+  Config::SetDefault ("ns3::PidQueueDisc::d", DoubleValue (+0.0005043));
+  Config::SetDefault ("ns3::PidQueueDisc::e", DoubleValue (-0.0002487));
+  Config::SetDefault ("ns3::PidQueueDisc::u0", DoubleValue (0.0085));
+  Config::SetDefault ("ns3::PidQueueDisc::Tupdate", TimeValue (Seconds (0.00625)));
+  Config::SetDefault ("ns3::PidQueueDisc::Supdate", TimeValue (Seconds (cfg.cstart)));
+  Config::SetDefault ("ns3::PidQueueDisc::Sstep", TimeValue (Seconds (cfg.cstart + 80)));
+  Config::SetDefault ("ns3::PidQueueDisc::DropProbTrace", BooleanValue (false));
+  Config::SetDefault ("ns3::PidQueueDisc::QueueSizeMeasurement", StringValue (cfg.useBql ? "Total" : "Device"));
+}
+
+/**
+ * \brief Build the dumbbell, install the bottleneck queue disc and the applications
+ * \param cfg the configuration
+ * \returns the nodes, the bottleneck and the applications
+ */
+inline Dumbbell
+BuildDumbbell (const DumbbellConfig &cfg)
+{
+  Dumbbell db;
+  uint32_t nLeaves = std::min (cfg.nFlows, cfg.maxLeaves);
+  NS_ABORT_MSG_IF (nLeaves == 0 || nLeaves > 16384, "nLeaves must be in [1, 16384]");
+
+  db.left.Create (nLeaves); db.routers.Create (2); db.right.Create (nLeaves);
+
+  PointToPointHelper leafLink;
+  leafLink.SetQueue ("ns3::DropTailQueue");
+  leafLink.SetDeviceAttribute ("DataRate", StringValue (cfg.leafRate));
+  leafLink.SetChannelAttribute ("Delay", StringValue (cfg.leafDelay));
+
+  DataRate rate (cfg.bottleneckRate);
+  if (cfg.scaleRate)
+    {
+      rate = DataRate (static_cast<uint64_t> (rate.GetBitRate () * (cfg.nFlows / 60.0)));
+    }
+  PointToPointHelper bottleneckLink;
+  bottleneckLink.SetQueue ("ns3::DropTailQueue");
+  bottleneckLink.SetDeviceAttribute ("DataRate", DataRateValue (rate));
+  bottleneckLink.SetChannelAttribute ("Delay", StringValue (cfg.bottleneckDelay));
+
+  InternetStackHelper stack;
+  stack.Install (db.left); stack.Install (db.routers); stack.Install (db.right);
+
+  NetDeviceContainer dRouter = bottleneckLink.Install (db.routers.Get (0), db.routers.Get (1));
+  db.bottleneckDevice = dRouter.Get (0);
+  TrafficControlHelper tchBottleneck;
+  tchBottleneck.SetRootQueueDisc (cfg.qDiscType);
+  if (cfg.useBql)
+    {
+      tchBottleneck.SetQueueLimits ("ns3::DynamicQueueLimits", "HoldTime", StringValue ("4ms"));
+    }
+  db.bottleneckQueueDisc = tchBottleneck.Install (db.bottleneckDevice).Get (0);
+
+  Ipv4AddressHelper ipv4L ("10.1.0.0", "255.255.255.252");
+  Ipv4AddressHelper ipv4RT ("10.2.0.0", "255.255.255.252");
+  Ipv4AddressHelper ipv4R ("10.3.0.0", "255.255.255.252");
+  ipv4RT.Assign (dRouter);
+
+  Ipv4InterfaceContainer ipcRightLeaf;
+  for (uint32_t i = 0; i < nLeaves; ++i)
+    {
+      ipv4L.Assign (leafLink.Install (db.left.Get (i), db.routers.Get (0)));
+      ipv4L.NewNetwork ();
+      Ipv4InterfaceContainer ipcRight = ipv4R.Assign (leafLink.Install (db.routers.Get (1), db.right.Get (i)));
+      ipcRightLeaf.Add (ipcRight.Get (1));
+      ipv4R.NewNetwork ();
+    }
+  Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
+
+  //only the bottleneck keeps a queue disc (Ipv4AddressHelper::Assign installs the default one on every other device)
+  TrafficControlHelper tch;
+  for (uint32_t i = 0; i < nLeaves; ++i)
+    {
+      tch.Uninstall (db.left.Get (i)->GetDevice (1));
+      tch.Uninstall (db.right.Get (i)->GetDevice (1));
+    }
+  for (uint32_t d = 1; d < db.routers.Get (0)->GetNDevices (); ++d)
+    {
+      if (db.routers.Get (0)->GetDevice (d) != db.bottleneckDevice)
+        {
+          tch.Uninstall (db.routers.Get (0)->GetDevice (d));
+        }
+    }
+  for (uint32_t d = 1; d < db.routers.Get (1)->GetNDevices (); ++d)
+    {
+      tch.Uninstall (db.routers.Get (1)->GetDevice (d));
+    }
+
+  uint16_t port = 8080;
+  BulkSendHelper source ("ns3::TcpSocketFactory", Address ());
+  source.SetAttribute ("MaxBytes", UintegerValue (0));
+  source.SetAttribute ("SendSize", UintegerValue (cfg.tcpMSSize));
+  for (uint32_t f = 0; f < cfg.nFlows; ++f)
+    {
+      uint32_t leaf = f % nLeaves;
+      source.SetAttribute ("Remote", AddressValue (InetSocketAddress (ipcRightLeaf.GetAddress (leaf), port)));
+      db.sources.Add (source.Install (db.left.Get (leaf)));
+    }
+  PacketSinkHelper sink ("ns3::TcpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), port));
+  db.sinks = sink.Install (db.right);
+  db.sources.Start (Seconds (cfg.cstart));
+  db.sources.Stop (Seconds (cfg.cstop));
+  db.sinks.Start (Seconds (0));
+  db.sinks.Stop (Seconds (cfg.cstop + 1));
+  return db;
+}
+
+} // namespace ns3
+
+#endif /* PID_DUMBBELL_H */
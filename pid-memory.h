@@ -0,0 +1,227 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) October 2021 : R. Olusegun Alli-Oke
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: R. Olusegun Alli-Oke <razkgb2012@gmail.com>, <razak.alli-oke@elizadeuniversity.edu.ng>
+ */
+
+// Memory of the dumbbell (pid-script.cc, pid-dumbbell.h) sampled during a run, by consumer: TCP send buffers (live
+// TcpTxItems from MemoryAccounting, and their data), TCP receive buffers, TCP socket state, queue disc items and the
+// packets of the device queues. Bytes are the buffered packet bytes plus the sizes of the objects that hold them
+// (shallow sizes, no allocator overhead), so their sum is a lower bound; the resident set size of the process is
+// sampled with them for comparison. The report gives the average and the peak over the samples, in total and per flow.
+
+
+#ifndef PID_MEMORY_H
+#define PID_MEMORY_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/traffic-control-module.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <unistd.h>             //sysconf
+
+namespace ns3 {
+
+class MemorySampler
+{
+public:
+  /// Memory consumers
+  enum Consumer
+  {
+    TCP_SEND_BUFFERS,           //TcpTxItems and the data of the TcpTxBuffers
+    TCP_RECEIVE_BUFFERS,        //data of the TcpRxBuffers
+    TCP_SOCKETS,                //TcpSocketBase, TcpSocketState, the buffer objects and the congestion control
+    QUEUE_DISC_ITEMS,           //items (and their packets) in the queue discs
+    DEVICE_QUEUES,              //packets in the device queues
+    CONSUMERS
+  };
+
+  /**
+   * \param sources the BulkSend applications (one per flow)
+   * \param sinks the PacketSink applications
+   * \param interval the sampling period
+   */
+  MemorySampler (ApplicationContainer sources, ApplicationContainer sinks, Time interval)
+    : m_sources (sources), m_sinks (sinks), m_interval (interval), m_nSamples (0)
+  {
+  }
+
+  /**
+   * \brief Sample from now on, every interval (call before or during Simulator::Run)
+   * \param start the first sample
+   */
+  void Start (Time start)
+  {
+    m_event = Simulator::Schedule (start, &MemorySampler::Sample, this);
+  }
+
+  /// Stop sampling
+  void Stop (void)
+  {
+    m_event.Cancel ();
+  }
+
+  /**
+   * \brief Print the average and peak objects and bytes of every consumer, in total and per flow
+   * \param os the output stream
+   */
+  void Report (std::ostream &os) const
+  {
+    static const char *names[CONSUMERS] = {"TCP send buffers", "TCP receive buffers", "TCP socket state",
+                                           "queue disc items", "device queues"};
+    uint32_t nFlows = std::max<uint32_t> (m_sources.GetN (), 1);
+    double n = std::max<uint64_t> (m_nSamples, 1);
+    os << "\nmemory (" << m_nSamples << " samples every " << m_interval.GetSeconds () << " s, " << m_sources.GetN () << " flows)" << std::endl;
+    os << std::left << std::setw (22) << "consumer" << std::right << std::setw (14) << "objects avg" << std::setw (14) << "objects peak"
+       << std::setw (14) << "bytes avg" << std::setw (14) << "bytes peak" << std::setw (14) << "B/flow avg" << std::setw (14) << "B/flow peak" << std::endl;
+    uint32_t largest = 0;
+    double sumAvg = 0;
+    for (uint32_t c = 0; c < CONSUMERS; ++c)
+      {
+        const Stats &s = m_stats[c];
+        os << std::left << std::setw (22) << names[c] << std::right << std::fixed << std::setprecision (0)
+           << std::setw (14) << s.objects / n << std::setw (14) << s.peakObjects << std::setw (14) << s.bytes / n
+           << std::setw (14) << s.peakBytes << std::setw (14) << s.bytes / n / nFlows << std::setw (14) << double (s.peakBytes) / nFlows
+           << std::defaultfloat << std::setprecision (6) << std::endl;
+        largest = (s.peakBytes > m_stats[largest].peakBytes) ? c : largest;
+        sumAvg += s.bytes / n;
+      }
+    os << "accounted " << sumAvg / (1 << 20) << " MB avg; resident set " << m_rss / n / (1 << 20) << " MB avg, "
+       << m_peakRss / double (1 << 20) << " MB peak (sampled); largest per-flow consumer: " << names[largest]
+       << " (" << double (m_stats[largest].peakBytes) / nFlows << " B/flow peak)\n" << std::endl;
+  }
+
+private:
+  struct Stats
+  {
+    double objects = 0;         //sum over the samples
+    double bytes = 0;           //sum over the samples
+    uint64_t peakObjects = 0;
+    uint64_t peakBytes = 0;
+  };
+
+  void Sample (void)
+  {
+    uint64_t objects[CONSUMERS] = {}, bytes[CONSUMERS] = {};
+
+    objects[TCP_SEND_BUFFERS] = MemoryAccounting::Get (MemoryAccounting::TCP_TX_ITEM).live;
+    bytes[TCP_SEND_BUFFERS] = objects[TCP_SEND_BUFFERS] * (sizeof (TcpTxItem) + 2 * sizeof (void *));   //+ std::list node links
+    for (uint32_t i = 0; i < m_sources.GetN (); ++i)
+      {
+        Ptr<BulkSendApplication> app = DynamicCast<BulkSendApplication> (m_sources.Get (i));
+        AddSocket (app ? app->GetSocket () : 0, objects, bytes);
+      }
+    for (uint32_t i = 0; i < m_sinks.GetN (); ++i)
+      {
+        Ptr<PacketSink> sink = DynamicCast<PacketSink> (m_sinks.Get (i));
+        if (sink)
+          {
+            for (Ptr<Socket> socket : sink->GetAcceptedSockets ())
+              {
+                AddSocket (socket, objects, bytes);
+              }
+          }
+      }
+
+    for (NodeList::Iterator node = NodeList::Begin (); node != NodeList::End (); ++node)
+      {
+        Ptr<TrafficControlLayer> tc = (*node)->GetObject<TrafficControlLayer> ();
+        for (uint32_t d = 0; d < (*node)->GetNDevices (); ++d)
+          {
+            Ptr<NetDevice> device = (*node)->GetDevice (d);
+            Ptr<QueueDisc> qd = tc ? tc->GetRootQueueDiscOnDevice (device) : 0;
+            if (qd)
+              {
+                objects[QUEUE_DISC_ITEMS] += qd->GetNPackets ();
+                bytes[QUEUE_DISC_ITEMS] += qd->GetNBytes () + qd->GetNPackets () * (sizeof (Ipv4QueueDiscItem) + sizeof (Packet));
+              }
+            Ptr<PointToPointNetDevice> p2p = DynamicCast<PointToPointNetDevice> (device);
+            if (p2p && p2p->GetQueue ())
+              {
+                objects[DEVICE_QUEUES] += p2p->GetQueue ()->GetNPackets ();
+                bytes[DEVICE_QUEUES] += p2p->GetQueue ()->GetNBytes () + p2p->GetQueue ()->GetNPackets () * sizeof (Packet);
+              }
+          }
+      }
+
+    for (uint32_t c = 0; c < CONSUMERS; ++c)
+      {
+        Stats &s = m_stats[c];
+        s.objects += objects[c];
+        s.bytes += bytes[c];
+        s.peakObjects = std::max (s.peakObjects, objects[c]);
+        s.peakBytes = std::max (s.peakBytes, bytes[c]);
+      }
+    uint64_t rss = ResidentSetSize ();
+    m_rss += rss;
+    m_peakRss = std::max (m_peakRss, rss);
+    ++m_nSamples;
+    m_event = Simulator::Schedule (m_interval, &MemorySampler::Sample, this);
+  }
+
+  static void AddSocket (Ptr<Socket> socket, uint64_t *objects, uint64_t *bytes)
+  {
+    Ptr<TcpSocketBase> tcp = DynamicCast<TcpSocketBase> (socket);
+    if (!tcp)
+      {
+        return;
+      }
+    bytes[TCP_SEND_BUFFERS] += tcp->GetTxBuffer ()->Size ();
+    if (tcp->GetRxBuffer ()->Size () > 0)
+      {
+        ++objects[TCP_RECEIVE_BUFFERS];
+        bytes[TCP_RECEIVE_BUFFERS] += tcp->GetRxBuffer ()->Size ();
+      }
+    ++objects[TCP_SOCKETS];
+    bytes[TCP_SOCKETS] += sizeof (TcpSocketBase) + sizeof (TcpSocketState) + sizeof (TcpTxBuffer) + sizeof (TcpRxBuffer) + sizeof (TcpNewReno);
+  }
+
+  static uint64_t ResidentSetSize (void)
+  {
+    unsigned long pages = 0, resident = 0;
+    FILE *f = std::fopen ("/proc/self/statm", "r");
+    if (f)
+      {
+        if (std::fscanf (f, "%lu %lu", &pages, &resident) != 2)
+          {
+            resident = 0;
+          }
+        std::fclose (f);
+      }
+    return uint64_t (resident) * sysconf (_SC_PAGESIZE);
+  }
+
+  ApplicationContainer m_sources;
+  ApplicationContainer m_sinks;
+  Time m_interval;
+  EventId m_event;
+  Stats m_stats[CONSUMERS];
+  uint64_t m_nSamples;
+  double m_rss = 0;             //sum over the samples
+  uint64_t m_peakRss = 0;
+};
+
+} // namespace ns3
+
+#endif /* PID_MEMORY_H */
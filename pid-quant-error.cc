@@ -0,0 +1,167 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) October 2021 : R. Olusegun Alli-Oke
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: R. Olusegun Alli-Oke <razkgb2012@gmail.com>, <razak.alli-oke@elizadeuniversity.edu.ng>
+ */
+
+// ===========================================================================
+//
+// Quantization error of the fixed-point PID AQM (FixedPointController, PidQueueDisc::FixedPoint) against the double
+// path, over a recorded run, without ns-3.
+//
+// The queue-size trace of pid-script.cc (nsplots/Jplots/qsizep.dat: time, packets in the netdevice queue, the queue
+// measured by the controller) is sampled every T from Supdate, with the step from q0 to qref at Sstep, and fed to two
+// cores with the Kahe2014 gains of pid-script.cc: one in double, one in fixed point. Both see the same measurements
+// (open loop), so the differences are those of the control law alone. Reported: the quantization error of the
+// coefficients and of u0, the error of the drop probability (max, mean and RMS absolute, max relative where
+// p >= 0.001), and the fraction of drop decisions that differ when both paths are given the same raw random bits.
+//
+// Build (outside ns-3):  g++ -O2 -std=c++11 -I src/traffic-control/model pid-quant-error.cc -o pid-quant-error
+// Run:                   ./pid-quant-error [qsizep.dat] [coefBits] [signalBits] [T] [Supdate] [Sstep] [q0] [qref]
+//
+// ===========================================================================
+
+
+#include "pid-aqm-core.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace ns3;
+
+//xorshift64*: 32 random bits
+class RawBits
+{
+public:
+  explicit RawBits (uint64_t seed) : m_s (seed) {}
+  uint32_t operator() (void)
+  {
+    m_s ^= m_s >> 12; m_s ^= m_s << 25; m_s ^= m_s >> 27;
+    return static_cast<uint32_t> ((m_s * 2685821657736338717ULL) >> 32);
+  }
+private:
+  uint64_t m_s;
+};
+
+
+int main (int argc, char *argv[])
+{
+  std::string file = (argc > 1) ? argv[1] : "nsplots/Jplots/qsizep.dat";
+  uint32_t coefBits = (argc > 2) ? std::strtoul (argv[2], 0, 10) : 30;
+  uint32_t signalBits = (argc > 3) ? std::strtoul (argv[3], 0, 10) : 24;
+  double T = (argc > 4) ? std::atof (argv[4]) : 0.00625;
+  double sUpdate = (argc > 5) ? std::atof (argv[5]) : 1;
+  double sStep = (argc > 6) ? std::atof (argv[6]) : 81;
+  double q0 = (argc > 7) ? std::atof (argv[7]) : 175;
+  double qref = (argc > 8) ? std::atof (argv[8]) : 475;
+  const uint32_t drawsPerTick = 100;
+
+  if (!FixedPointController::Accepts (coefBits, signalBits))
+    {
+      std::cerr << "unsupported Q-format: " << coefBits << " coefficient bits, " << signalBits << " signal bits" << std::endl;
+      return 1;
+    }
+
+  std::vector<double> times, sizes;
+  std::ifstream in (file.c_str ());
+  double t, q;
+  while (in >> t >> q)
+    {
+      times.push_back (t);
+      sizes.push_back (q);
+    }
+  if (times.empty ())
+    {
+      std::cerr << "no samples in " << file << std::endl;
+      return 1;
+    }
+
+  //Kahe2014, as in pid-script.cc
+  const std::vector<double> num = {-0.0002556, +0.0005043, -0.0002487};
+  const std::vector<double> den = {1.8290, -0.8290};
+  const double u0 = 0.0085;
+
+  PidAqmCore dbl, fxd;
+  dbl.SetController (CreateDiscreteController (num, den));
+  dbl.Configure (u0, false, false);
+  dbl.Reset (-1);
+  FixedPointController *fpc = new FixedPointController (num, den, coefBits, signalBits);
+  fxd.SetController (std::unique_ptr<DiscreteController> (fpc));
+  fxd.Configure (u0, false, false);
+  fxd.SetFixedPoint (signalBits);
+  fxd.Reset (-1);
+
+  std::cout << "Q-format: " << coefBits << " coefficient bits, " << signalBits << " signal bits" << std::endl;
+  std::vector<double> qnum, qden;
+  fpc->GetCoefficients (qnum, qden);
+  const char *names[] = {"c", "d", "e", "a", "b"};
+  for (uint32_t i = 0; i < 5; ++i)
+    {
+      double v = (i < 3) ? num[i] : den[i - 3];
+      double qv = (i < 3) ? qnum[i] : qden[i - 3];
+      std::cout << names[i] << " = " << v << "\tquantized " << qv << "\trelative error " << std::abs (qv - v) / std::abs (v) << std::endl;
+    }
+  double qu0 = FixedPointController::ToDouble (FixedPointController::ToFixed (u0, signalBits), signalBits);
+  std::cout << "u0 = " << u0 << "\tquantized " << qu0 << "\trelative error " << std::abs (qu0 - u0) / u0 << std::endl;
+
+  RawBits bits (12345);
+  uint64_t ticks = 0, decisions = 0, mismatches = 0;
+  double maxAbs = 0, sumAbs = 0, sumSq = 0, maxRel = 0;
+  std::size_t next = 0;
+  double last = 0;
+  for (double tick = sUpdate; tick <= times.back (); tick = sUpdate + (++ticks) * T)
+    {
+      while (next < times.size () && times[next] <= tick)
+        {
+          last = sizes[next++];                         //queue size at the tick: latest change before it
+        }
+      double ref = (tick < sStep) ? q0 : qref;
+      dbl.SetReference (ref);
+      fxd.SetReference (ref);
+      double pd = dbl.Update (last);
+      double pf = fxd.Update (last);
+
+      double err = std::abs (pf - pd);
+      maxAbs = std::max (maxAbs, err);
+      sumAbs += err;
+      sumSq += err * err;
+      if (pd >= 0.001)
+        {
+          maxRel = std::max (maxRel, err / pd);
+        }
+      for (uint32_t k = 0; k < drawsPerTick; ++k)
+        {
+          uint32_t b = bits ();
+          bool dropDouble = dbl.DropEarly ([b] () { return std::ldexp (double (b), -32); });
+          bool dropFixed = fxd.DropEarlyRaw ([b] () { return b; });
+          mismatches += (dropDouble != dropFixed);
+          ++decisions;
+        }
+    }
+
+  std::cout << "\nticks: " << ticks << " (T = " << T << " s, from " << sUpdate << " s, step at " << sStep << " s)" << std::endl;
+  std::cout << "drop probability error: max " << maxAbs << "\tmean " << sumAbs / ticks << "\tRMS " << std::sqrt (sumSq / ticks)
+            << "\tmax relative (p >= 0.001) " << maxRel << std::endl;
+  std::cout << "drop decisions differing: " << mismatches << " of " << decisions << " (" << double (mismatches) / decisions << ")" << std::endl;
+  return 0;
+}
@@ -30,11 +30,16 @@
 #include "ns3/double.h"
 #include "ns3/simulator.h"
 #include "ns3/abort.h"
+#include "ns3/assert.h"
 #include "pid-queue-disc.h"                     //also for ->GetNetDeviceQueueInterface ()
 #include "ns3/drop-tail-queue.h"
 #include "ns3/net-device-queue-interface.h"     //for ->GetTxQueue
-#include "ns3/trace-helper.h"
+#include "ns3/hot-path-timer.h"                 //PID_HOTPATH_TIMER, compiled out unless PID_HOTPATH_TIMING is defined
 #include "ns3/pointer.h"
+#include "ns3/string.h"
+#include <sstream>
+#include <algorithm>
+#include <cmath>
 
 
 namespace ns3 
@@ -42,7 +47,16 @@ namespace ns3
 
 NS_LOG_COMPONENT_DEFINE ("PidQueueDisc");
 
+template class PidQueueDiscT<PiPolicy>;
+template class PidQueueDiscT<PdPolicy>;
+template class PidQueueDiscT<PidPolicy>;
+template class PidQueueDiscT<GenericPolicy>;
+
 NS_OBJECT_ENSURE_REGISTERED (PidQueueDisc);
+NS_OBJECT_ENSURE_REGISTERED (PiQueueDisc);
+NS_OBJECT_ENSURE_REGISTERED (PdQueueDisc);
+NS_OBJECT_ENSURE_REGISTERED (PidPolicyQueueDisc);
+NS_OBJECT_ENSURE_REGISTERED (GenericPidQueueDisc);
 
 TypeId PidQueueDisc::GetTypeId (void)
     {
@@ -80,6 +94,46 @@ TypeId PidQueueDisc::GetTypeId (void)
                        DoubleValue (0.0),
                        MakeDoubleAccessor (&PidQueueDisc::m_u0),
                        MakeDoubleChecker<double> ())
+        .AddAttribute ("NumeratorCoefficients",
+                       "Error coefficients of an arbitrary-order controller, e.g. \"c d e\" (if both lists are empty, a..e are used)",
+                       StringValue (""),
+                       MakeStringAccessor (&PidQueueDisc::m_numCoeffs),
+                       MakeStringChecker ())
+        .AddAttribute ("DenominatorCoefficients",
+                       "Output coefficients of an arbitrary-order controller, e.g. \"a b\" (if both lists are empty, a..e are used)",
+                       StringValue (""),
+                       MakeStringAccessor (&PidQueueDisc::m_denCoeffs),
+                       MakeStringChecker ())
+        .AddAttribute ("AntiWindup",
+                       "Store the saturated drop probability in the controller history",
+                       BooleanValue (false),
+                       MakeBooleanAccessor (&PidQueueDisc::m_antiWindup),
+                       MakeBooleanChecker ())
+        .AddAttribute ("WarmStart",
+                       "Start at the linearization equilibrium: drop with probability u0 from the start, also in open loop",
+                       BooleanValue (false),
+                       MakeBooleanAccessor (&PidQueueDisc::m_warmStart),
+                       MakeBooleanChecker ())
+        .AddAttribute ("UsePWM",
+                       "Drop deterministically with the duty cycle given by the drop probability (pulse-width modulation) instead of randomly",
+                       BooleanValue (false),
+                       MakeBooleanAccessor (&PidQueueDisc::m_usePwm),
+                       MakeBooleanChecker ())
+        .AddAttribute ("FixedPoint",
+                       "Run the controller in fixed-point (integer) arithmetic, and draw the drop decisions by integer comparison with raw random bits",
+                       BooleanValue (false),
+                       MakeBooleanAccessor (&PidQueueDisc::m_fixedPoint),
+                       MakeBooleanChecker ())
+        .AddAttribute ("FixedPointCoefficientBits",
+                       "Fractional bits of the fixed-point coefficients (Q-format of a..e)",
+                       UintegerValue (30),
+                       MakeUintegerAccessor (&PidQueueDisc::m_coefBits),
+                       MakeUintegerChecker<uint32_t> (1, 61))
+        .AddAttribute ("FixedPointSignalBits",
+                       "Fractional bits of the fixed-point errors and drop probabilities (coefficient + signal bits at most 62)",
+                       UintegerValue (24),
+                       MakeUintegerAccessor (&PidQueueDisc::m_signalBits),
+                       MakeUintegerChecker<uint32_t> (1, 61))
         .AddAttribute ("Sstep",
                        "Start time to step-change in desired queue-length",
                        TimeValue (Seconds (0.0)),
@@ -96,10 +150,15 @@ TypeId PidQueueDisc::GetTypeId (void)
                        MakeTimeAccessor (&PidQueueDisc::m_tUpdate),
                        MakeTimeChecker ())
         .AddAttribute ("MaxSize",
-                       "The maximum number of packets accepted by this queue disc",
+                       "The maximum number of packets (or bytes: byte mode) accepted by this queue disc",
                        QueueSizeValue (QueueSize ("1p")),
                        MakeQueueSizeAccessor (&PidQueueDisc::m_queueLimit),
                        MakeQueueSizeChecker ())
+        .AddAttribute ("MeanPktSize",
+                       "Average packet size (bytes): in byte mode, the drop probability of a packet is scaled by its size over this",
+                       UintegerValue (1000),
+                       MakeUintegerAccessor (&PidQueueDisc::m_meanPktSize),
+                       MakeUintegerChecker<uint32_t> (1))
         .AddAttribute ("QueueSizeReferenceEQ",
                        "Equilibrium queue size used to approximate Model",
                        QueueSizeValue (QueueSize ("1p")),
@@ -110,6 +169,80 @@ TypeId PidQueueDisc::GetTypeId (void)
                        QueueSizeValue (QueueSize ("1p")),
                        MakeQueueSizeAccessor (&PidQueueDisc::m_QsizeRefDQ),
                        MakeQueueSizeChecker ())
+        .AddAttribute ("DropProbTrace",
+                       "Append the drop probability to DropProbTraceFile at every update",
+                       BooleanValue (true),
+                       MakeBooleanAccessor (&PidQueueDisc::m_dropProbTrace),
+                       MakeBooleanChecker ())
+        .AddAttribute ("DropProbTraceFile",
+                       "File to which the drop probability is appended at every update (time, unsaturated and saturated drop probability, "
+                       "PWM phase or random value, disc id); the discs tracing to the same file share one writer, and their lines are told apart by the disc id",
+                       StringValue ("nsplots/Jplots/dprobp.dat"),
+                       MakeStringAccessor (&PidQueueDisc::m_dropProbTraceFile),
+                       MakeStringChecker ())
+        .AddAttribute ("UseEcn",
+                       "Mark ECT packets instead of dropping them on early (unforced) decisions",
+                       BooleanValue (false),
+                       MakeBooleanAccessor (&PidQueueDisc::m_useEcn),
+                       MakeBooleanChecker ())
+        .AddAttribute ("EcnDropThreshold",
+                       "Drop probability above which ECT packets are dropped instead of marked (if UseEcn)",
+                       DoubleValue (1.0),
+                       MakeDoubleAccessor (&PidQueueDisc::m_ecnDropThreshold),
+                       MakeDoubleChecker<double> (0, 1))
+        .AddAttribute ("SteadyStateWindow",
+                       "Number of controller samples of the steady-state detection window (0 disables detection)",
+                       UintegerValue (0),
+                       MakeUintegerAccessor (&PidQueueDisc::m_ssWindow),
+                       MakeUintegerChecker<uint32_t> ())
+        .AddAttribute ("SteadyStateQueueTolerance",
+                       "Tolerance on the windowed mean and standard deviation of the queue-size error (packets, bytes in byte mode, or ms if UseQueueDelay)",
+                       DoubleValue (10.0),
+                       MakeDoubleAccessor (&PidQueueDisc::m_ssQueueTol),
+                       MakeDoubleChecker<double> (0))
+        .AddAttribute ("SteadyStateProbTolerance",
+                       "Tolerance on the windowed standard deviation of the drop probability",
+                       DoubleValue (0.001),
+                       MakeDoubleAccessor (&PidQueueDisc::m_ssProbTol),
+                       MakeDoubleChecker<double> (0))
+        .AddAttribute ("SteadyStateSamples",
+                       "Number of steady-state samples to collect once the response has settled",
+                       UintegerValue (1000),
+                       MakeUintegerAccessor (&PidQueueDisc::m_ssSamples),
+                       MakeUintegerChecker<uint32_t> ())
+        .AddAttribute ("StopOnSteadyState",
+                       "Stop the simulator once SteadyStateSamples steady-state samples are collected",
+                       BooleanValue (false),
+                       MakeBooleanAccessor (&PidQueueDisc::m_ssStop),
+                       MakeBooleanChecker ())
+        .AddAttribute ("UseQueueDelay",
+                       "Control the queue delay (in ms) instead of the queue size. The delay is measured in the queue of QueueSizeMeasurement: the "
+                       "sojourn time of the packets dequeued from the disc (Disc), the drain time of the netdevice TxQueue backlog at the device DataRate "
+                       "(Device), or both added up (Total)",
+                       BooleanValue (false),
+                       MakeBooleanAccessor (&PidQueueDisc::m_useQueueDelay),
+                       MakeBooleanChecker ())
+        .AddAttribute ("QueueDelayReferenceEQ",
+                       "Equilibrium queue delay used to approximate Model (if UseQueueDelay)",
+                       TimeValue (MilliSeconds (0)),
+                       MakeTimeAccessor (&PidQueueDisc::m_qDelayRefEQ),
+                       MakeTimeChecker ())
+        .AddAttribute ("QueueDelayReferenceDQ",
+                       "Desired queue delay (if UseQueueDelay)",
+                       TimeValue (MilliSeconds (0)),
+                       MakeTimeAccessor (&PidQueueDisc::m_qDelayRefDQ),
+                       MakeTimeChecker ())
+        .AddAttribute ("QueueSizeMeasurement",
+                       "Queue whose size is fed to the controller: the netdevice TxQueue, the queue disc, or both (e.g. with BQL)",
+                       EnumValue (MEASURE_DEVICE),
+                       MakeEnumAccessor (&PidQueueDisc::m_measurement),
+                       MakeEnumChecker (MEASURE_DEVICE, "Device",
+                                        MEASURE_DISC, "Disc",
+                                        MEASURE_TOTAL, "Total"))
+        .AddTraceSource ("Arrival",
+                         "Packet arriving at the queue disc, before any drop decision (e.g. to record arrivals for replay)",
+                         MakeTraceSourceAccessor (&PidQueueDisc::m_arrivalTrace),
+                         "ns3::QueueDiscItem::TracedCallback")
       ;
 
       return tid;
@@ -124,12 +257,18 @@ TypeId PidQueueDisc::GetTypeId (void)
 
 // KEY METHOD 0: CONSTRUCTOR ( step a)
 PidQueueDisc::PidQueueDisc ()
- : QueueDisc (QueueDiscSizePolicy::SINGLE_INTERNAL_QUEUE)
+ : QueueDisc (QueueDiscSizePolicy::SINGLE_INTERNAL_QUEUE),
+   m_byteMode (false),
+   m_active (false),
+   m_follower (false),
+   m_leader (0)
     {
+      static uint32_t nDiscs = 0;
+      m_traceId = nDiscs++;
       NS_LOG_FUNCTION (this);
       m_uv = CreateObject<UniformRandomVariable> ();
       //int64_t strmm = 123456; m_uv->SetStream (strmm);    // globally done via "RngSeedManager::SetSeed(1)" in pid-script.cc
-      std::cout << "\t\trng stream: " <<  m_uv->GetStream () << "\n" << std::endl;
+      NS_LOG_INFO ("rng stream: " << m_uv->GetStream ());
     }
 
 // KEY METHOD 1: Check Configuration (step b)
@@ -147,6 +286,9 @@ bool PidQueueDisc::CheckConfig (void)
           NS_LOG_ERROR ("PidQueueDisc cannot have packet filters");
           return false;
         }
+      //The internal queue stays a DropTailQueue: Queue<Item> keeps its items in a private std::list, and the QueueBase counters and the
+      //Enqueue/Dequeue/Drop traces (from which QueueDisc keeps its statistics) are only updated by Queue::DoEnqueue/DoDequeue, so a
+      //contiguous ring buffer cannot be substituted from this module without patching src/network/utils/queue.h.
       if (GetNInternalQueues () == 0)
         {
           AddInternalQueue (CreateObjectWithAttributes<DropTailQueue<QueueDiscItem> > ("MaxSize", QueueSizeValue (m_queueLimit)));
@@ -156,35 +298,134 @@ bool PidQueueDisc::CheckConfig (void)
           NS_LOG_ERROR ("PidQueueDisc needs 1 internal queue");
           return false;
         }
+      //byte mode (MaxSize in bytes): the queue is measured, referenced and limited in bytes, so the references must be in bytes too
+      m_byteMode = (m_queueLimit.GetUnit () == QueueSizeUnit::BYTES);
+      if (!m_useQueueDelay && (m_QsizeRefEQ.GetUnit () != m_queueLimit.GetUnit () || m_QsizeRefDQ.GetUnit () != m_queueLimit.GetUnit ()))
+        {
+          NS_LOG_ERROR ("PidQueueDisc queue size references must be in the unit of MaxSize (" << m_queueLimit << ")");
+          return false;
+        }
+      std::vector<double> num, den;
+      if (!GetCoefficients (num, den))
+        {
+          NS_LOG_ERROR ("PidQueueDisc has malformed controller coefficients");
+          return false;
+        }
+      std::unique_ptr<DiscreteController> controller;
+      if (m_fixedPoint)
+        {
+          //the fixed-point controller is of arbitrary order: the compile-time policy of PidQueueDiscT is not used
+          if (!FixedPointController::Accepts (m_coefBits, m_signalBits))
+            {
+              NS_LOG_ERROR ("PidQueueDisc fixed-point format Q" << m_coefBits << "/Q" << m_signalBits << " is not supported");
+              return false;
+            }
+          controller.reset (new FixedPointController (num, den, m_coefBits, m_signalBits));
+        }
+      else
+        {
+          controller = CreateController (num, den);
+        }
+      if (!controller)
+        {
+          NS_LOG_ERROR ("PidQueueDisc coefficients do not fit the controller policy of " << GetInstanceTypeId ().GetName ());
+          return false;
+        }
+      m_core.SetController (std::move (controller));
+      m_core.Configure (m_u0, m_antiWindup, m_usePwm);
+      m_core.SetFixedPoint (m_fixedPoint ? m_signalBits : 0);
 
       return true;
     }
    
 
+// KEY METHOD 1b: Create Controller (called by CheckConfig, overridden by the compile-time policies of PidQueueDiscT)
+std::unique_ptr<DiscreteController> PidQueueDisc::CreateController (const std::vector<double> &num, const std::vector<double> &den)
+    {
+      NS_LOG_FUNCTION (this);
+      return CreateDiscreteController (num, den);
+    }
+
+
 // KEY METHOD 2: Intialize Parameters of PID (step c)
 void PidQueueDisc::InitializeParams (void)
     {
       // Initially queue is empty so variables are initialize to zero.
-      m_dropProb = -1;                  // ensures that there is no drop when in open loop.
-      m_dropProb1 = 0;                  //since it is linearized controller (ie du0).
-      m_dropProb2 = 0;
-      m_ErrQsize1 = 0; 
-      m_ErrQsize2 = 0;
+      // A drop probability of -1 ensures that there is no drop when in open loop; with a warm start, flows and queue
+      // start at the operating point (w0, q0), so drop with u0 from the start.
+      // Since it is linearized controller (ie du0), previous drop probabilities and errors are zero, also at the operating point of a warm start.
+      m_core.Reset (m_warmStart ? m_u0 : -1);
+      m_ssErr.Resize (m_ssWindow);
+      m_ssProb.Resize (m_ssWindow);
+      m_ssCount = 0;
+      m_ssTime = Seconds (-1);
       m_QsizeRef = m_QsizeRefEQ;
-      std::cout << "linearization equilibrium queue-length (q0): " <<  m_QsizeRef.GetValue() << std::endl;
-      m_rtrsEvent1 = Simulator::Schedule (m_sStep, &PidQueueDisc::QSizeRefUpdate, this);   //effects step-change from linearization equlibrium point (q0) to desired reference queue-length (qref)
-      m_rtrsEvent2 = Simulator::Schedule (m_sUpdate, &PidQueueDisc::CalculateP, this);     //starts the computation of drop-ratio method (CalculateP) i.e. initiates the closed-loop control
+      m_qDelayRef = m_qDelayRefEQ;
+      m_qDelay = Time (0);
+      if (m_useQueueDelay)
+        {
+          std::cout << "linearization equilibrium queue-delay (q0, ms): " <<  m_qDelayRef.GetMilliSeconds () << std::endl;
+        }
+      else
+        {
+          std::cout << "linearization equilibrium queue-length (q0): " <<  m_QsizeRef.GetValue() << std::endl;
+        }
+      m_active = false;                 //the step-change and CalculateP events are scheduled by Activate, at the first enqueue
+    }
+
+
+// KEY METHOD 2b: Activate (first enqueue)
+void PidQueueDisc::Activate (void)
+    {
+      NS_LOG_FUNCTION (this);
+      m_active = true;
+      if (m_follower)
+        {
+          if (m_leader && !m_leader->m_active)
+            {
+              m_leader->Activate ();    //the controller runs from the first enqueue on any of the discs, not only on the leading one
+            }
+          return;                       //the drop probability is set by the controller of the leading disc
+        }
+      Time now = Simulator::Now ();
+      bool stepped = false;
+
+      //samples due up to now (the queue has been empty until this first arrival); the step-change comes first at equal times
+      Time tick = m_sUpdate;
+      for (; m_tUpdate.IsStrictlyPositive () && tick <= now; tick += m_tUpdate)
+        {
+          if (!stepped && m_sStep <= tick)
+            {
+              QSizeRefUpdate ();
+              stepped = true;
+            }
+          ControllerTick (tick);
+        }
+
+      if (!stepped)
+        {
+          m_rtrsEvent1 = Simulator::Schedule (Max (m_sStep - now, Time (0)), &PidQueueDisc::QSizeRefUpdate, this);   //effects step-change from linearization equlibrium point (q0) to desired reference queue-length (qref)
+        }
+      m_rtrsEvent2 = Simulator::Schedule (Max (tick - now, Time (0)), &PidQueueDisc::CalculateP, this);               //starts (or resumes) the computation of drop-ratio method (CalculateP) i.e. initiates the closed-loop control
     }
    
 
 // KEY METHOD 3: DoEnqueue (step d)
 bool PidQueueDisc::DoEnqueue (Ptr<QueueDiscItem> item)
     {
+      PID_HOTPATH_TIMER ("PidQueueDisc::DoEnqueue");
       NS_LOG_FUNCTION (this << item);   
-      QueueSize nQueued = this->GetCurrentSize();                             
-      bool bv =DropEarly (item);
+      if (!m_active)
+        {
+          Activate ();
+        }
+      m_arrivalTrace (item);
+      uint32_t nQueued = m_byteMode ? GetNBytes () : GetNPackets ();
+      bool overLimit = nQueued + (m_byteMode ? item->GetSize () : 1) > m_queueLimit.GetValue ();
+      //the random value is drawn for every arrival (same rng stream); the PWM phase only advances on arrivals that pass the limit
+      bool bv = (overLimit && m_usePwm) ? false : DropEarly (item);
       
-      if (nQueued == m_queueLimit)                                         
+      if (overLimit)
         {
           //Drops due to queue limit: reactive --> drops packet if qdisc-queue size exceeds queue limit
           DropBeforeEnqueue (item, FORCED_DROP);
@@ -192,11 +433,16 @@ bool PidQueueDisc::DoEnqueue (Ptr<QueueDiscItem> item)
         }
       else if (bv)
         {  
-          //Early probability drop: proactive --> calls the DropEarly sub-method --> which uses m_dropProb from the CalculateP sub-method
-          DropBeforeEnqueue (item, UNFORCED_DROP);
-          return false;
+          //Early probability drop: proactive --> calls the DropEarly sub-method --> which uses the drop probability from the CalculateP sub-method
+          //In ECN mode, ECT packets are marked (and enqueued) instead, unless the drop probability exceeds the threshold; Mark fails for non-ECT packets
+          if (!m_useEcn || m_core.GetDropProb () > m_ecnDropThreshold || !Mark (item, UNFORCED_MARK))
+            {
+              DropBeforeEnqueue (item, UNFORCED_DROP);
+              return false;
+            }
         }
           //No Drop
+      item->SetTimeStamp (Simulator::Now ());                                 //arrival time, for the sojourn time measured in DoDequeue
       bool retval = GetInternalQueue (0)->Enqueue (item);
 
           //If Queue::Enqueue fails, QueueDisc::DropBeforeEnqueue is called by the internal queue because QueueDisc::AddInternalQueue sets the trace callback
@@ -211,6 +457,7 @@ bool PidQueueDisc::DoEnqueue (Ptr<QueueDiscItem> item)
 // KEY METHOD 4: DoDequeue (step e)
 Ptr<QueueDiscItem> PidQueueDisc::DoDequeue ()
     {
+      PID_HOTPATH_TIMER ("PidQueueDisc::DoDequeue");
       NS_LOG_FUNCTION (this);   
 
       if (GetInternalQueue (0)->IsEmpty ())
@@ -220,6 +467,7 @@ Ptr<QueueDiscItem> PidQueueDisc::DoDequeue ()
         }
 
       Ptr<QueueDiscItem> item = GetInternalQueue (0)->Dequeue ();
+      m_qDelay = Simulator::Now () - item->GetTimeStamp ();                  //sojourn time (queue delay) of this packet
       
       return item;
     }
@@ -233,8 +481,16 @@ void PidQueueDisc::DoDispose (void)
    {
      NS_LOG_FUNCTION (this);
      m_uv = 0;
-     Simulator::Remove (m_rtrsEvent1);
-     Simulator::Remove (m_rtrsEvent2);
+     m_txQueue = 0;
+     m_core.SetController (nullptr);
+     for (Ptr<PidQueueDisc> follower : m_followers)
+       {
+         follower->m_leader = 0;
+       }
+     m_followers.clear ();
+     m_rtrsEvent1.Cancel ();
+     m_rtrsEvent2.Cancel ();
+     m_dropProbWriter.reset ();
      QueueDisc::DoDispose ();
    }
 
@@ -243,6 +499,8 @@ void PidQueueDisc::DoDispose (void)
 PidQueueDisc::~PidQueueDisc ()
    {
      NS_LOG_FUNCTION (this);
+     m_rtrsEvent1.Cancel ();            //the events hold a raw pointer: a disc uninstalled (and released) without being disposed must not leave them behind
+     m_rtrsEvent2.Cancel ();
    }
 
 
@@ -256,64 +514,236 @@ PidQueueDisc::~PidQueueDisc ()
    
 bool PidQueueDisc::DropEarly (Ptr<QueueDiscItem> item)                          
     { 
+      PID_HOTPATH_TIMER ("PidQueueDisc::DropEarly");
       NS_LOG_FUNCTION (this << item);      
-      double p = m_dropProb;
-      double v =  m_uv->GetValue ();
          
       //DropEarly is bypassed if queue (disc) has less than a couple of packets.OMITTED.
       
-      //DropEarly is bypassed if DropProbability p is less than the random variable v \in [0, 1]
-      if (p < v)                                                      
+      //DropEarly is bypassed if DropProbability p is less than the random variable v \in [0, 1]; with PWM, every (1/p)-th arrival is dropped and no rng is drawn.
+      //In byte mode, p is scaled by the packet size over MeanPktSize, so that large packets are more likely dropped (as in PIE and RED byte mode)
+      if (m_fixedPoint)
         {
-          //if (p < 0) { std::cout << "No Drop: " << "\t" << Simulator::Now ().GetSeconds () << "\t" << p << std::endl;} 	// checking to make sure that there is no drop in open-loop mode
-          return false;  //dont drop packet
+          //integer comparison of the Q32 drop probability with 32 raw random bits (one draw, as GetValue)
+          return m_core.DropEarlyRaw ([this] () { return m_uv->GetInteger (0, 0xffffffff); }, m_byteMode ? item->GetSize () : 1, m_byteMode ? m_meanPktSize : 1);
         }
-
-      return true;       //drop packet
+      double scale = m_byteMode ? double (item->GetSize ()) / m_meanPktSize : 1.0;
+      return m_core.DropEarly ([this] () { return m_uv->GetValue (); }, scale);
     }
 
 
 void PidQueueDisc::CalculateP () 
     {
+      PID_HOTPATH_TIMER ("PidQueueDisc::CalculateP");
       NS_LOG_FUNCTION (this);
-      double pp;
+      m_rtrsEvent2 = Simulator::Schedule (m_tUpdate, &PidQueueDisc::CalculateP, this);
+      ControllerTick (Simulator::Now ());
+    }
+
+
+void PidQueueDisc::ControllerTick (Time now) 
+    {
+      NS_LOG_FUNCTION (this << now);
       //QueueSize nQueued = this->GetCurrentSize();   					                 //current queue size (packets) of qdisc (internal) queue
-            Ptr<NetDeviceQueueInterface> qti = this->GetNetDeviceQueueInterface () ;
+      Ptr<NetDeviceQueueInterface> qti = this->GetNetDeviceQueueInterface () ;
+      if (!m_txQueue && qti && m_measurement != MEASURE_DISC)
+        {
             Ptr<NetDevice> ndd = qti->GetObject<NetDevice>(); 
             PointerValue ptrV; ndd->GetAttribute ("TxQueue", ptrV);
-            Ptr<Queue<Packet>> txQueue = ptrV.Get<Queue<Packet>>();
-      m_Qsize = txQueue->GetCurrentSize();             							//current queue size (packets) of netdevice (external) queue
-      m_ErrQsize0 = double(m_QsizeRef.GetValue()) - double(m_Qsize.GetValue());  	                //current error
+            m_txQueue = ptrV.Get<Queue<Packet>>();                                                   //the device queue does not change: looked up once
+            DataRateValue rate;
+            NS_ABORT_MSG_IF (m_useQueueDelay && !ndd->GetAttributeFailSafe ("DataRate", rate),
+                             "PidQueueDisc UseQueueDelay with QueueSizeMeasurement Device or Total needs a device with a DataRate");
+            m_linkRate = rate.Get ();                                                                //drain rate of the device queue (UseQueueDelay)
+        }
+      //in the unit of MaxSize (bytes in byte mode), whatever the unit of the netdevice queue
+      QueueSizeUnit unit = m_queueLimit.GetUnit ();
+      if (!m_txQueue)
+        {
+          m_Qsize = QueueSize (unit, m_byteMode ? GetNBytes () : GetNPackets ());                        //own (internal) queue; also a stand-alone disc (no netdevice, e.g. trace replay)
+        }
+      else if (m_measurement == MEASURE_TOTAL)
+        {
+          m_Qsize = QueueSize (unit, m_byteMode ? GetNBytes () + m_txQueue->GetNBytes () : GetNPackets () + m_txQueue->GetNPackets ());   //backlog of the link: qdisc and netdevice queues
+        }
+      else
+        {
+          m_Qsize = QueueSize (unit, m_byteMode ? m_txQueue->GetNBytes () : m_txQueue->GetNPackets ());  //current queue size of netdevice (external) queue
+        }
+      double measurement;
+      if (m_useQueueDelay)
+        {
+          if (GetInternalQueue (0)->IsEmpty ())
+            {
+              m_qDelay = Time (0);                                                               //the last sojourn time is stale once the queue has drained
+            }
+          m_core.SetReference (m_qDelayRef.GetSeconds () * 1000.0);                               //error in ms
+          measurement = (m_txQueue && m_measurement == MEASURE_DEVICE) ? 0 : m_qDelay.GetSeconds () * 1000.0;
+          if (m_txQueue)
+            {
+              //the backlog of the netdevice queue (the whole backlog without BQL) is not seen by the sojourn time in the disc
+              measurement += m_linkRate.CalculateBytesTxTime (m_txQueue->GetNBytes ()).GetSeconds () * 1000.0;
+            }
+          for (const Ptr<PidQueueDisc> &f : m_followers)
+            {
+              if (!f->GetInternalQueue (0)->IsEmpty ())
+                {
+                  measurement = std::max (measurement, f->m_qDelay.GetSeconds () * 1000.0);      //shared controller: the slowest queue
+                }
+            }
+        }
+      else
+        {
+          for (const Ptr<PidQueueDisc> &f : m_followers)
+            {
+              m_Qsize = QueueSize (unit, m_Qsize.GetValue () + (m_byteMode ? f->GetNBytes () : f->GetNPackets ()));   //shared controller: aggregate backlog
+            }
+          m_core.SetReference (double(m_QsizeRef.GetValue()));
+          measurement = double(m_Qsize.GetValue());
+        }
      
       //PID ( tustin (integral term) + backward difference (differential term) )  ;  (see equation 15) 
-      m_dropProb0 = (m_a * m_dropProb1)  + (m_b * m_dropProb2)  +  ( m_c * m_ErrQsize0 )  +  ( m_d * m_ErrQsize1 )  +  ( m_e * m_ErrQsize2 );     //unsaturated drop probability, m_dropProb0
+      //the controller stores the current and previous unsaturated drop probabilities and errors; m_u0 is added after it (see equation 18 and Figure 5),
+      //and saturation comes after equation 18 and not before it (see Figure 5). With PWM, the drop probability is latched as the duty cycle.
+      m_core.Update (measurement);
+      for (const Ptr<PidQueueDisc> &f : m_followers)
+        {
+          f->m_core.SetDropProb (m_core.GetDropProb ());
+        }
 
-      m_dropProb2 = m_dropProb1;    m_dropProb1 = m_dropProb0;               // store current and previous unsaturated drop probabilities .....m_dropProb0 needs to be stored before adding m_u0, see below
-      m_ErrQsize2 = m_ErrQsize1;   m_ErrQsize1 = m_ErrQsize0;                           // store current and previous errors
+      if (m_ssWindow > 0)
+        {
+          CheckSteadyState (now);
+        }
+      
+    //CalculateP schedules the next m_tUpdate of m_rtrsEvent2 before this; worst case, we miss some data points, doesnt affect computation of control action (drop probability)
+    //the record is formatted and appended to m_dropProbTraceFile by the writer thread
+      double phase = m_usePwm ? m_core.GetPwmPhase () : m_uv->GetValue();        //drawn even when not traced: same random stream either way
+      if (m_dropProbTrace)
+        {
+          if (!m_dropProbWriter || m_dropProbWriter->GetFileName () != m_dropProbTraceFile)
+            {
+              m_dropProbWriter = AsyncTraceWriter::GetShared (m_dropProbTraceFile);   //also when the file is changed, e.g. by a forked variant
+            }
+          m_dropProbWriter->Push (AsyncTraceWriter::Record (now.GetSeconds ()).Add (m_core.GetUnsaturatedDropProb ()).Add (m_core.GetDropProb ()).Add (phase).AddInt (m_traceId));
+        }
+    }
 
-      m_dropProb0 = m_u0 + m_dropProb0;              							// (see equation 18);  m_u0 needs to be added, see Figure 5
 
-      pp = (m_dropProb0 <= 0) ? 0 : m_dropProb0; m_dropProb = (pp <= 1) ? pp : 1;                       //saturated drop probability, m_dropProb . Saturation comes after equation 18 and not before it,  see Figure 5
+void PidQueueDisc::CheckSteadyState (Time now) 
+    {
+      NS_LOG_FUNCTION (this << now);
+      if (now < m_sStep)
+        {
+          return;                                                                 //only the post-step response is of interest
+        }
+      m_ssErr.Add (m_core.GetError ());
+      m_ssProb.Add (m_core.GetDropProb ());
+      if (!m_ssErr.IsFull ())
+        {
+          return;
+        }
 
-      m_rtrsEvent2 = Simulator::Schedule (m_tUpdate, &PidQueueDisc::CalculateP, this);
-      
-    //preferably after scheduling an m_tUpdate of m_rtrsEvent2; worst case, we miss some data points, doesnt affect computation of control action m_dropProb
-      AsciiTraceHelper asciiTraceHelper;  Ptr<OutputStreamWrapper> stream1b = asciiTraceHelper.CreateFileStream ("nsplots/Jplots/dprobp.dat",std::ios::app); 
-      *stream1b->GetStream () << Simulator::Now ().GetSeconds () << "\t" << m_dropProb0 << "\t" << m_dropProb << "\t" << m_uv->GetValue() << std::endl;
+      bool steady = std::abs (m_ssErr.GetMean ()) <= m_ssQueueTol && m_ssErr.GetStdDev () <= m_ssQueueTol && m_ssProb.GetStdDev () <= m_ssProbTol;
+      if (!steady)
+        {
+          m_ssCount = 0;                                                          //left the tolerance band: start over
+          m_ssTime = Seconds (-1);
+          return;
+        }
+      if (m_ssCount++ == 0)
+        {
+          m_ssTime = now - Seconds (m_tUpdate.GetSeconds () * (m_ssWindow - 1));    //start of the first steady window
+          std::cout << "steady state reached at " << m_ssTime.GetSeconds () << " s (mean error " << m_ssErr.GetMean () << ", mean drop probability " << m_ssProb.GetMean () << ")\n" << std::endl;
+        }
+      if (m_ssStop && m_ssCount >= m_ssSamples)
+        {
+          std::cout << "collected " << m_ssCount << " steady-state samples, stopping at " << now.GetSeconds () << " s\n" << std::endl;
+          Simulator::Stop ();
+        }
     }
 
 
-void PidQueueDisc::QSizeRefUpdate () 
+Time PidQueueDisc::GetSteadyStateTime (void) const
     {
-     NS_LOG_FUNCTION (this);
-     m_QsizeRef = m_QsizeRefDQ;
-     std::cout << "desired set-point reference queue-length (qref): " <<  m_QsizeRef.GetValue() << "\n" << std::endl;
+      return m_ssTime;
     }
 
 
-void PidQueueDisc::PWMUpdate () 
+uint32_t PidQueueDisc::GetSteadyStateSamples (void) const
+    {
+      return m_ssCount;
+    }
+
+
+void PidQueueDisc::AddFollower (Ptr<PidQueueDisc> follower)
+    {
+      NS_LOG_FUNCTION (this << follower);
+      NS_ASSERT_MSG (follower != this && !m_follower && follower->m_followers.empty (), "a shared controller has one leading disc");
+      follower->m_follower = true;
+      follower->m_leader = this;
+      m_followers.push_back (follower);
+    }
+
+
+void PidQueueDisc::FlushTraces (void)
+    {
+      NS_LOG_FUNCTION (this);
+      if (m_dropProbWriter)
+        {
+          m_dropProbWriter->Stop ();
+        }
+    }
+
+
+bool PidQueueDisc::UpdateCoefficients (void)
+    {
+      NS_LOG_FUNCTION (this);
+      std::vector<double> num, den;
+      return m_core.GetController () && GetCoefficients (num, den) && m_core.GetController ()->SetCoefficients (num, den);
+    }
+
+
+bool PidQueueDisc::ParseCoefficients (const std::string &str, std::vector<double> &coeffs)
+    {
+      std::string list = str;
+      std::replace (list.begin (), list.end (), ',', ' ');
+      std::istringstream iss (list);
+      double v;
+      coeffs.clear ();
+      while (iss >> v)
+        {
+          coeffs.push_back (v);
+        }
+      return iss.eof ();
+    }
+
+
+bool PidQueueDisc::GetCoefficients (std::vector<double> &num, std::vector<double> &den) const
+    {
+      if (m_numCoeffs.empty () && m_denCoeffs.empty ())
+        {
+          num = {m_c, m_d, m_e};        //uk = (a * u_{k-1})  + (b * u_{k-2})  +  ( c * e_{k} )  +  ( d * e_{k-1} )  +  ( e * e_{k-2} )
+          den = {m_a, m_b};
+          return true;
+        }
+      //arbitrary-order controller: both lists are used, an empty DenominatorCoefficients gives a FIR (e.g. PD) controller
+      return ParseCoefficients (m_numCoeffs, num) && ParseCoefficients (m_denCoeffs, den) && !num.empty ();
+    }
+
+
+void PidQueueDisc::QSizeRefUpdate () 
     {
      NS_LOG_FUNCTION (this);
+     m_QsizeRef = m_QsizeRefDQ;
+     m_qDelayRef = m_qDelayRefDQ;
+     if (m_useQueueDelay)
+       {
+         std::cout << "desired set-point reference queue-delay (qref, ms): " <<  m_qDelayRef.GetMilliSeconds () << "\n" << std::endl;
+       }
+     else
+       {
+         std::cout << "desired set-point reference queue-length (qref): " <<  m_QsizeRef.GetValue() << "\n" << std::endl;
+       }
     }
 
 
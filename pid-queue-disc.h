@@ -29,6 +29,15 @@
 #include "ns3/timer.h"
 #include "ns3/event-id.h"
 #include "ns3/random-variable-stream.h"
+#include "ns3/traced-callback.h"
+#include "ns3/pid-controller.h"
+#include "ns3/pid-aqm-core.h"
+#include "ns3/async-trace-writer.h"
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
 
 
 namespace ns3 {
@@ -36,6 +45,81 @@ namespace ns3 {
 class TraceContainer;
 class UniformRandomVariable;
 
+/**
+ * \ingroup traffic-control
+ *
+ * \brief Mean and standard deviation over the last N samples (ring buffer), for the steady-state detection of
+ *        PidQueueDisc. Both are computed from the samples in the window, the deviation from the deviations to the
+ *        mean (two passes), so that the errors in bytes of byte mode lose no precision to a difference of large sums.
+ */
+class SlidingWindowStats
+{
+public:
+  SlidingWindowStats ()
+    : m_head (0), m_count (0)
+    {
+    }
+
+  /**
+   * \brief Set the window length and clear the samples
+   * \param n number of samples
+   */
+  void Resize (std::size_t n)
+    {
+      m_samples.assign (n, 0);
+      m_head = m_count = 0;
+    }
+
+  void Add (double x)
+    {
+      if (m_samples.empty ())
+        {
+          return;
+        }
+      if (m_count < m_samples.size ())
+        {
+          ++m_count;
+        }
+      m_samples[m_head] = x;
+      m_head = (m_head + 1 == m_samples.size ()) ? 0 : m_head + 1;
+    }
+
+  bool IsFull (void) const
+    {
+      return !m_samples.empty () && m_count == m_samples.size ();
+    }
+
+  double GetMean (void) const
+    {
+      double sum = 0;
+      for (std::size_t i = 0; i < m_count; ++i)
+        {
+          sum += m_samples[i];          //the window is m_samples[0, m_count) until it is full, then all of it
+        }
+      return (m_count == 0) ? 0 : sum / m_count;
+    }
+
+  double GetStdDev (void) const
+    {
+      if (m_count == 0)
+        {
+          return 0;
+        }
+      double mean = GetMean ();
+      double sumSq = 0;
+      for (std::size_t i = 0; i < m_count; ++i)
+        {
+          sumSq += (m_samples[i] - mean) * (m_samples[i] - mean);
+        }
+      return std::sqrt (std::max (sumSq / m_count, 0.0));
+    }
+
+private:
+  std::vector<double> m_samples;        //!< ring buffer of the last samples
+  std::size_t m_head;                   //!< index of the oldest sample (next to be overwritten)
+  std::size_t m_count;                  //!< number of samples in the window
+};
+
 /**
  * \ingroup traffic-control
  *
@@ -60,16 +144,71 @@ public:
    */
   virtual ~PidQueueDisc ();
 
+  /**
+   * \brief Queue whose size is fed to the controller
+   */
+  enum QueueSizeMeasurement
+  {
+    MEASURE_DEVICE,   //!< netdevice (external) TxQueue, as in the validation experiment
+    MEASURE_DISC,     //!< this queue disc (internal queue)
+    MEASURE_TOTAL     //!< queue disc and netdevice TxQueue, e.g. with dynamic queue limits (BQL) on the device
+  };
+
+  /**
+   * \brief Reload the controller coefficients (a..e or the coefficient lists) from the attributes, keeping
+   *        the controller history, e.g. to change the gains of a running simulation
+   * \returns false if the new coefficients are malformed or do not fit the controller
+   */
+  bool UpdateCoefficients (void);
+
+  /**
+   * \brief Get the time at which the post-step response settled (start of the first steady-state window)
+   * \returns the settling time, or a negative time if the response has not settled (or detection is disabled)
+   */
+  Time GetSteadyStateTime (void) const;
+
+  /**
+   * \brief Get the number of steady-state samples collected since the response settled
+   * \returns the number of samples
+   */
+  uint32_t GetSteadyStateSamples (void) const;
+
+  /**
+   * \brief Share this disc's controller with another disc (e.g. the other TX queues of MqPidQueueDisc): the follower's
+   *        backlog is added to the measured queue size (the largest delay is taken with UseQueueDelay), and the
+   *        follower drops with the drop probability computed here instead of running its own controller.
+   *        To be called before the discs are initialized.
+   * \param follower the disc driven by this one
+   */
+  void AddFollower (Ptr<PidQueueDisc> follower);
+
+  /**
+   * \brief Write out the pending drop probability records and stop the trace writer thread (e.g. before fork);
+   *        it restarts at the next record, appending to DropProbTraceFile. The writer is shared by the discs that
+   *        trace to the same file.
+   */
+  void FlushTraces (void);
+
 
    // Reasons for dropping packets
   static constexpr const char* UNFORCED_DROP = "Unforced drop";  //!< Early probability drops: proactive
   static constexpr const char* FORCED_DROP = "Forced drop";      //!< Drops due to queue limit: reactive
+  // Reasons for marking packets
+  static constexpr const char* UNFORCED_MARK = "Unforced mark";  //!< Early probability marks: proactive
 
 protected:
   /**
    * \brief Dispose of the object
    */
   virtual void DoDispose (void);
+
+  /**
+   * \brief Create the difference-equation controller
+   * \param num numerator (error) coefficients
+   * \param den denominator (output) coefficients
+   * \returns the controller, or a null pointer if the coefficients are not supported
+   */
+  virtual std::unique_ptr<DiscreteController> CreateController (const std::vector<double> &num, const std::vector<double> &den);
  
 
 private:
@@ -78,6 +217,7 @@ private:
   Time m_tUpdate;                                              //!< compute drop probability every m_tUpdate secs (i.e. 1/m_tUpdate is the sampling frequency of discrete PID controller)
   Time m_sStep;                                                //!< start step-change to desired queue-length from linearation equilibrium queue-length
   QueueSize  m_queueLimit;                                     //!< maximum queue-size of qdisc (internal) queue
+  uint32_t m_meanPktSize;                                      //!< average packet size (bytes), scales the drop probability in byte mode
   QueueSize  m_QsizeRef;                                       //!< variable for storing m_QsizeRefEQ or m_QsizeRefDQ
   QueueSize  m_QsizeRefEQ;                                     //!< Linearization equilibrium queue size
   QueueSize  m_QsizeRefDQ;                                     //!< Desired set-point reference queue size
@@ -87,20 +227,51 @@ private:
   double m_d;                                                  //!< d parameter to PID difference-equation controller
   double m_e;                                                  //!< e parameter to PID difference-equation controller
   double m_u0;                                                 //!< Linearization equilbrium packet-loss ratio
+  std::string m_numCoeffs;                                     //!< numerator (error) coefficients of an arbitrary-order controller, overrides a..e
+  std::string m_denCoeffs;                                     //!< denominator (output) coefficients of an arbitrary-order controller, overrides a..e
+  bool m_antiWindup;                                           //!< store the saturated (instead of unsaturated) drop probability in the controller history
+  bool m_warmStart;                                            //!< start at the linearization equilibrium (drop with u0 from the start) instead of with no drop
+  bool m_usePwm;                                               //!< pulse-width-modulated (deterministic) actuation instead of random early drops
+  bool m_fixedPoint;                                           //!< fixed-point (integer) controller and drop decision
+  uint32_t m_coefBits;                                         //!< fractional bits of the fixed-point coefficients
+  uint32_t m_signalBits;                                       //!< fractional bits of the fixed-point errors and drop probabilities
+  bool m_dropProbTrace;                                        //!< append the drop probability to m_dropProbTraceFile
+  std::string m_dropProbTraceFile;                             //!< file to which CalculateP appends the drop probability
+  std::shared_ptr<AsyncTraceWriter> m_dropProbWriter;          //!< writer of m_dropProbTraceFile, shared with the other discs tracing to it
+  uint32_t m_traceId;                                          //!< disc id in the drop probability trace (creation order)
+  bool m_useEcn;                                               //!< ECN-mark (instead of drop) ECT packets chosen by DropEarly
+  double m_ecnDropThreshold;                                   //!< drop probability above which ECT packets are dropped rather than marked
+  uint32_t m_ssWindow;                                         //!< steady-state detection window (controller samples), 0 disables detection
+  double m_ssQueueTol;                                         //!< tolerance on the mean and standard deviation of the queue-size (or delay) error
+  double m_ssProbTol;                                          //!< tolerance on the standard deviation of the drop probability
+  uint32_t m_ssSamples;                                        //!< number of steady-state samples to collect before stopping
+  bool m_ssStop;                                               //!< stop the simulator once m_ssSamples steady-state samples are collected
+  bool m_useQueueDelay;                                        //!< feed the controller the queue delay (ms, in the queue of m_measurement) instead of the queue size
+  Time m_qDelayRefEQ;                                          //!< Linearization equilibrium queue delay
+  Time m_qDelayRefDQ;                                          //!< Desired set-point reference queue delay
+  QueueSizeMeasurement m_measurement;                          //!< queue whose size is fed to the controller
   
   
   // ** Variables maintained by PID  
-  QueueSize  m_Qsize;                                          //!< current value of external queue size
-  double m_dropProb;                                           //!< Variable used in calculation of drop probability
-  double m_dropProb0;                                          //!< current-step current value of of drop probability
-  double m_dropProb1;                                          //!< 1-step previous value of drop probability
-  double m_dropProb2;                                          //!< 2-step previous value of drop probability
-  double m_ErrQsize0;                                          //!< current-step current value of queue-size error
-  double m_ErrQsize1;                                          //!< 1-step previous value of queue-size error
-  double m_ErrQsize2;                                          //!< 2-step previous value of queue-size error
+  QueueSize  m_Qsize;                                          //!< current value of the measured queue size
+  bool m_byteMode;                                             //!< queue measured, referenced and limited in bytes (MaxSize in bytes)
+  Ptr<Queue<Packet> > m_txQueue;                               //!< netdevice (external) TxQueue, looked up at the first CalculateP
+  DataRate m_linkRate;                                         //!< netdevice DataRate, to turn the TxQueue backlog into a delay (UseQueueDelay)
+  Time m_qDelayRef;                                            //!< variable for storing m_qDelayRefEQ or m_qDelayRefDQ
+  Time m_qDelay;                                               //!< sojourn time of the last dequeued packet
+  PidAqmCore m_core;                                           //!< control law and drop decision (controller, drop probability, PWM state)
+  bool m_active;                                               //!< controller events scheduled (at the first enqueue)
+  bool m_follower;                                             //!< driven by the controller of another disc (no controller events)
+  std::vector<Ptr<PidQueueDisc> > m_followers;                 //!< discs driven by this disc's controller
+  PidQueueDisc *m_leader;                                      //!< disc whose controller drives this one (not a Ptr: the leader holds its followers)
   EventId m_rtrsEvent1;                                        //!< Event used to start (periodioc) computation of drop probability 
   EventId m_rtrsEvent2;                                        //!< Event used to repeatedly-schedule (periodioc) computation of drop probability 
   Ptr<UniformRandomVariable> m_uv;                             //!< Rng stream, random variable for comparison with computed drop probability
+  SlidingWindowStats m_ssErr;                                  //!< windowed statistics of the queue-size (or delay) error after the step
+  SlidingWindowStats m_ssProb;                                 //!< windowed statistics of the drop probability after the step
+  uint32_t m_ssCount;                                          //!< steady-state samples collected since the response settled
+  Time m_ssTime;                                               //!< time at which the response settled
+  TracedCallback<Ptr<const QueueDiscItem> > m_arrivalTrace;    //!< every packet arriving at the disc, before any drop decision
 
   /**
    * \brief Check if a packet needs to be dropped due to probability drop
@@ -116,6 +287,36 @@ private:
    * is going, up or down
    */
   void CalculateP ();
+
+  /**
+   * \brief One controller sample: measure the queue, update the drop probability, check for steady state and trace
+   * \param now time of the sample (earlier than the current time for the samples run by Activate)
+   */
+  void ControllerTick (Time now);
+
+  /**
+   * \brief Schedule the controller events at the first enqueue, so that a disc that never carries traffic (or is
+   *        uninstalled before it does) costs no events. The samples due before activation, on an empty queue, are run
+   *        first, so that the controller state is the same as if the events had been scheduled at initialization.
+   *        A follower activates its leader instead (the shared controller starts at the first enqueue on any disc).
+   */
+  void Activate (void);
+
+  /**
+   * \brief Parse a space- or comma-separated list of coefficients
+   * \param str the list
+   * \param coeffs the parsed coefficients
+   * \returns false if the list is malformed
+   */
+  static bool ParseCoefficients (const std::string &str, std::vector<double> &coeffs);
+
+  /**
+   * \brief Get the controller coefficients, either from a..e or from the coefficient lists
+   * \param num numerator (error) coefficients
+   * \param den denominator (output) coefficients
+   * \returns false if the coefficient lists are malformed
+   */
+  bool GetCoefficients (std::vector<double> &num, std::vector<double> &den) const;
   virtual bool CheckConfig (void);
    /**
    * \brief Initialize the queue parameters.
@@ -124,13 +325,63 @@ private:
   virtual Ptr<QueueDiscItem> DoDequeue (void);
   virtual bool DoEnqueue (Ptr<QueueDiscItem> item);
   virtual void QSizeRefUpdate ();
-  virtual void PWMUpdate ();
+
+  /**
+   * \brief Online convergence detector, evaluated by CalculateP after the step-change: the response has settled when,
+   *        over the last m_ssWindow samples, the mean and standard deviation of the error and the standard deviation
+   *        of the drop probability are within tolerance. Optionally stops the simulator after m_ssSamples such samples.
+   */
+  void CheckSteadyState (Time now);
  
   
  
   
 };
 
+
+/**
+ * \ingroup traffic-control
+ *
+ * \brief PidQueueDisc whose controller is specialized at compile time for a policy (PiPolicy, PdPolicy, PidPolicy,
+ *        GenericPolicy), so that the terms absent from the policy are not evaluated. Registered as
+ *        ns3::PidQueueDisc<PI>, ns3::PidQueueDisc<PD>, ns3::PidQueueDisc<PID> and ns3::PidQueueDisc<Generic>.
+ */
+template <class Policy>
+class PidQueueDiscT : public PidQueueDisc
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+protected:
+  virtual std::unique_ptr<DiscreteController> CreateController (const std::vector<double> &num, const std::vector<double> &den);
+};
+
+template <class Policy>
+TypeId PidQueueDiscT<Policy>::GetTypeId (void)
+    {
+      static TypeId tid = TypeId (("ns3::PidQueueDisc<" + std::string (Policy::GetName ()) + ">").c_str ())
+        .SetParent<PidQueueDisc> ()
+        .SetGroupName ("TrafficControl")
+        .AddConstructor<PidQueueDiscT<Policy> > ()
+      ;
+      return tid;
+    }
+
+template <class Policy>
+std::unique_ptr<DiscreteController> PidQueueDiscT<Policy>::CreateController (const std::vector<double> &num, const std::vector<double> &den)
+    {
+      return CreatePolicyController<Policy> (num, den);
+    }
+
+typedef PidQueueDiscT<PiPolicy> PiQueueDisc;                  //!< ns3::PidQueueDisc<PI>
+typedef PidQueueDiscT<PdPolicy> PdQueueDisc;                  //!< ns3::PidQueueDisc<PD>
+typedef PidQueueDiscT<PidPolicy> PidPolicyQueueDisc;          //!< ns3::PidQueueDisc<PID>
+typedef PidQueueDiscT<GenericPolicy> GenericPidQueueDisc;     //!< ns3::PidQueueDisc<Generic>
+
 };   // namespace ns3
 
 #endif
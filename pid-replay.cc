@@ -0,0 +1,191 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) October 2021 : R. Olusegun Alli-Oke
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: R. Olusegun Alli-Oke <razkgb2012@gmail.com>, <razak.alli-oke@elizadeuniversity.edu.ng>
+ */
+
+// ===========================================================================
+//
+// Open-loop trace-driven replay of the bottleneck (LeftRouterR) of pid-script.cc.
+//
+// In open-loop mode (pstart = sstart in pid-script.cc) the arrival process at the bottleneck does not depend on the
+// controller, so it is recorded once (recordArrivals = true in pid-script.cc, file arrivals.bin) and replayed here
+// directly into a stand-alone PidQueueDisc, which is served at the bottleneck rate. TCP, routing and the leaf nodes
+// are not simulated. The controller parameters below must match those of the recorded run.
+//
+// This file is to be placed in "\\scratch" folder together with pid-arrivals.h.
+//
+// ===========================================================================
+
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/traffic-control-module.h"
+#include "pid-arrivals.h"
+
+#include <iostream>
+#include <algorithm>
+#include <vector>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("PidReplay");
+
+//queue disc item carrying a replayed arrival (no header, not ECN-capable, hash is the recorded flow id)
+class ReplayQueueDiscItem : public QueueDiscItem
+{
+public:
+  ReplayQueueDiscItem (Ptr<Packet> p, uint32_t flowId) : QueueDiscItem (p, Address (), 0), m_flowId (flowId) {}
+  virtual void AddHeader (void) {}
+  virtual bool Mark (void) { return false; }
+  virtual uint32_t Hash (uint32_t perturbation) const { return m_flowId ^ perturbation; }
+private:
+  uint32_t m_flowId;
+};
+
+//bottleneck modeled as a queue disc served at a constant rate
+class ReplayBottleneck
+{
+public:
+  ReplayBottleneck (Ptr<QueueDisc> qdisc, const std::vector<ArrivalRecord> *arrivals, DataRate rate, uint32_t overhead)
+    : m_qdisc (qdisc), m_arrivals (arrivals), m_next (0), m_rate (rate), m_overhead (overhead), m_busy (false), m_busyTime (0) {}
+
+  //schedule the arrivals one at a time, so that the event list stays short
+  void Start (void)
+  {
+    if (m_next < m_arrivals->size ())
+      {
+        Simulator::Schedule (NanoSeconds ((*m_arrivals)[m_next].timeNs), &ReplayBottleneck::Arrival, this);
+      }
+  }
+
+  void Arrival (void)
+  {
+    const ArrivalRecord &r = (*m_arrivals)[m_next++];
+    m_qdisc->Enqueue (Create<ReplayQueueDiscItem> (Create<Packet> (r.size), r.flowId));
+    if (m_next < m_arrivals->size ())
+      {
+        Simulator::Schedule (NanoSeconds ((*m_arrivals)[m_next].timeNs) - Simulator::Now (), &ReplayBottleneck::Arrival, this);
+      }
+    if (!m_busy)
+      {
+        Transmit ();
+      }
+  }
+
+  void Transmit (void)
+  {
+    Ptr<QueueDiscItem> item = m_qdisc->Dequeue ();
+    if (!item)
+      {
+        m_busy = false;
+        return;
+      }
+    m_busy = true;
+    m_delays.push_back ((Simulator::Now () - item->GetTimeStamp ()).GetSeconds ());
+    Time txTime = m_rate.CalculateBytesTxTime (item->GetSize () + m_overhead);
+    m_busyTime += txTime;
+    Simulator::Schedule (txTime, &ReplayBottleneck::Transmit, this);
+  }
+
+  void Report (double duration)
+  {
+    std::sort (m_delays.begin (), m_delays.end ());
+    std::cout << "replayed arrivals: " << m_next << "\tdeparted: " << m_delays.size () << "\tutilization: " << m_busyTime.GetSeconds () / duration << std::endl;
+    if (!m_delays.empty ())
+      {
+        std::cout << "queueing delay (ms): p50 = " << 1000 * m_delays[m_delays.size () / 2] << "\tp90 = " << 1000 * m_delays[m_delays.size () * 9 / 10]
+                  << "\tp99 = " << 1000 * m_delays[m_delays.size () * 99 / 100] << "\tmax = " << 1000 * m_delays.back () << std::endl;
+      }
+    std::cout << m_qdisc->GetStats () << std::endl;
+  }
+
+private:
+  Ptr<QueueDisc> m_qdisc;
+  const std::vector<ArrivalRecord> *m_arrivals;
+  size_t m_next;                        //index of the next arrival
+  DataRate m_rate;                      //bottleneck rate
+  uint32_t m_overhead;                  //link-layer header bytes (PPP: 2)
+  bool m_busy;                          //transmitting
+  Time m_busyTime;                      //total transmission time
+  std::vector<double> m_delays;         //sojourn time of each departed packet (s)
+};
+
+
+int main (int argc, char *argv[])
+{
+    std::string arrivalsFile = "nsplots/Jplots/arrivals.bin";
+    std::string qDiscType = "ns3::PidQueueDisc<PID>";
+    std::string bottleneckRate = "15Mbps";
+    double T = 0.00625, u0 = 0.0085;
+    double a = 1.8290, b = -0.8290, c = -0.0002556, d = +0.0005043, e = -0.0002487;  //Kahe2014, (see equation 16)
+    double pstart = 1, sstart = 81;
+    uint32_t qDiscLimitPkts = 800, QsizeRefPktsEQ = 175, QsizeRefPktsDQ = 475;
+
+    CommandLine cmd;
+    cmd.AddValue ("arrivals", "arrival file recorded by pid-script", arrivalsFile);
+    cmd.AddValue ("qDiscType", "queue disc type", qDiscType);
+    cmd.AddValue ("rate", "bottleneck rate", bottleneckRate);
+    cmd.AddValue ("T", "controller period (s)", T);
+    cmd.AddValue ("u0", "linearization equilibrium drop probability", u0);
+    cmd.AddValue ("a", "PID parameter a", a);
+    cmd.AddValue ("b", "PID parameter b", b);
+    cmd.AddValue ("c", "PID parameter c", c);
+    cmd.AddValue ("d", "PID parameter d", d);
+    cmd.AddValue ("e", "PID parameter e", e);
+    cmd.AddValue ("pstart", "start of the drop probability computation (s)", pstart);
+    cmd.AddValue ("sstart", "step-change time (s)", sstart);
+    cmd.AddValue ("limit", "queue disc limit (packets)", qDiscLimitPkts);
+    cmd.AddValue ("q0", "linearization equilibrium queue-length (packets)", QsizeRefPktsEQ);
+    cmd.AddValue ("qref", "desired reference queue-length (packets)", QsizeRefPktsDQ);
+    cmd.Parse (argc, argv);
+
+    std::vector<ArrivalRecord> arrivals = ReadArrivals (arrivalsFile);
+    NS_ABORT_MSG_IF (arrivals.empty (), "no arrivals in " << arrivalsFile);
+    std::cout << "read " << arrivals.size () << " arrivals from " << arrivalsFile << "\n" << std::endl;
+
+    ObjectFactory factory;
+    factory.SetTypeId (qDiscType);
+    factory.Set ("MaxSize", QueueSizeValue (QueueSize (QueueSizeUnit::PACKETS, qDiscLimitPkts)));
+    factory.Set ("QueueSizeReferenceEQ", QueueSizeValue (QueueSize (QueueSizeUnit::PACKETS, QsizeRefPktsEQ)));
+    factory.Set ("QueueSizeReferenceDQ", QueueSizeValue (QueueSize (QueueSizeUnit::PACKETS, QsizeRefPktsDQ)));
+    factory.Set ("a", DoubleValue (a));
+    factory.Set ("b", DoubleValue (b));
+    factory.Set ("c", DoubleValue (c));
+    factory.Set ("d", DoubleValue (d));
+    factory.Set ("e", DoubleValue (e));
+    factory.Set ("u0", DoubleValue (u0));
+    factory.Set ("Tupdate", TimeValue (Seconds (T)));
+    factory.Set ("Supdate", TimeValue (Seconds (pstart)));
+    factory.Set ("Sstep", TimeValue (Seconds (sstart)));
+    factory.Set ("DropProbTraceFile", StringValue ("nsplots/Jplots/dprobp_replay.dat"));
+    remove ("nsplots/Jplots/dprobp_replay.dat");
+
+    Ptr<QueueDisc> qdisc = factory.Create<QueueDisc> ();
+    qdisc->Initialize ();
+
+    ReplayBottleneck bottleneck (qdisc, &arrivals, DataRate (bottleneckRate), 2);
+    bottleneck.Start ();
+
+    double duration = arrivals.back ().timeNs * 1e-9;
+    Simulator::Stop (NanoSeconds (arrivals.back ().timeNs) + Seconds (1));
+    Simulator::Run ();
+    bottleneck.Report (duration);
+    Simulator::Destroy ();
+
+    return 0;
+}
@@ -0,0 +1,253 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) October 2021 : R. Olusegun Alli-Oke
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: R. Olusegun Alli-Oke <razkgb2012@gmail.com>, <razak.alli-oke@elizadeuniversity.edu.ng>
+ */
+
+// ===========================================================================
+//
+// Scaling benchmark of the pid-script.cc workload (pid-dumbbell.h, PidQueueDisc bottleneck) from 10 to 10,000 flows.
+// The bottleneck rate is scaled with the number of flows (DumbbellConfig::scaleRate), so that the per-flow share of
+// the link, hence the per-flow window, stays that of pid-script.cc. Each run is a forked child, so that every run
+// starts from the same (empty) ns-3 state and its peak resident set is its own.
+//
+// Traces as in pid-script.cc (with traces=true): the cwnd of every flow, the bottleneck queue disc size and the
+// drop probability (DropProbTraceFile), written as text into traceDir.
+//
+// Reported per run: setup wall time, run wall time, executed events, events per wall second, simulated seconds per
+// wall second, peak resident set (wait4), trace bytes and the bytes received by the sinks; as a table on the standard
+// output and as JSON into the json file, the baseline to compare every performance change against.
+//
+// ./waf --run "pid-scaling-bench --flows=10,100,1000,10000 --simTime=10 --json=pid-scaling.json"
+//
+// This file is to be placed in "\\scratch" folder together with pid-dumbbell.h.
+//
+// ===========================================================================
+
+
+#include "pid-dumbbell.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unistd.h>             //fork, pipe
+#include <sys/resource.h>       //rusage
+#include <sys/stat.h>           //stat
+#include <sys/wait.h>           //wait4
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("PidScalingBench");
+
+struct BenchResult
+{
+  double setupSecs;
+  double runSecs;
+  double simSecs;
+  uint64_t events;
+  uint64_t traceBytes;
+  uint64_t rxBytes;
+  uint64_t bottleneckBps;
+};
+
+static void
+CwndTrace (std::ofstream *os, uint32_t flow, uint32_t oldCwnd, uint32_t newCwnd)
+{
+  *os << Simulator::Now ().GetSeconds () << "\t" << flow << "\t" << newCwnd << "\n";
+}
+
+static void
+QueueTrace (std::ofstream *os, uint32_t oldValue, uint32_t newValue)
+{
+  *os << Simulator::Now ().GetSeconds () << "\t" << newValue << "\n";
+}
+
+//the sockets of the BulkSend sources exist once the applications have started
+static void
+ConnectCwndTraces (ApplicationContainer sources, std::ofstream *os)
+{
+  for (uint32_t i = 0; i < sources.GetN (); ++i)
+    {
+      Ptr<Socket> socket = DynamicCast<BulkSendApplication> (sources.Get (i))->GetSocket ();
+      if (socket)
+        {
+          socket->TraceConnectWithoutContext ("CongestionWindow", MakeBoundCallback (&CwndTrace, os, i));
+        }
+    }
+}
+
+static uint64_t
+FileBytes (const std::string &file)
+{
+  struct stat st;
+  return (stat (file.c_str (), &st) == 0) ? st.st_size : 0;
+}
+
+static BenchResult
+RunOnce (uint32_t nFlows, uint32_t maxLeaves, double simTime, bool traces, std::string traceDir)
+{
+  typedef std::chrono::steady_clock Clock;
+  DumbbellConfig cfg;
+  cfg.nFlows = nFlows;
+  cfg.maxLeaves = maxLeaves;
+  cfg.cstop = cfg.cstart + simTime;
+  SetPidScriptDefaults (cfg);
+
+  std::ostringstream prefix;
+  prefix << traceDir << "/" << nFlows << "-";
+  std::vector<std::string> files = {prefix.str () + "cwnd.dat", prefix.str () + "qsize.dat", prefix.str () + "dprob.dat"};
+  if (traces)
+    {
+      SystemPath::MakeDirectories (traceDir);
+      for (const std::string &file : files)
+        {
+          std::remove (file.c_str ());          //the drop probability trace is appended to
+        }
+      Config::SetDefault ("ns3::PidQueueDisc::DropProbTrace", BooleanValue (true));
+      Config::SetDefault ("ns3::PidQueueDisc::DropProbTraceFile", StringValue (files[2]));
+    }
+
+  Clock::time_point t0 = Clock::now ();
+  Dumbbell db = BuildDumbbell (cfg);
+  std::ofstream cwndFile, qsizeFile;
+  if (traces)
+    {
+      cwndFile.open (files[0].c_str ());
+      qsizeFile.open (files[1].c_str ());
+      Simulator::Schedule (Seconds (cfg.cstart + 0.001), &ConnectCwndTraces, db.sources, &cwndFile);
+      db.bottleneckQueueDisc->TraceConnectWithoutContext ("PacketsInQueue", MakeBoundCallback (&QueueTrace, &qsizeFile));
+    }
+  Clock::time_point t1 = Clock::now ();
+  Simulator::Stop (Seconds (cfg.cstop));
+  Simulator::Run ();
+  Clock::time_point t2 = Clock::now ();
+
+  BenchResult r;
+  r.setupSecs = std::chrono::duration<double> (t1 - t0).count ();
+  r.runSecs = std::chrono::duration<double> (t2 - t1).count ();
+  r.simSecs = Simulator::Now ().GetSeconds ();
+  r.events = Simulator::GetEventCount ();
+  r.rxBytes = 0;
+  for (uint32_t i = 0; i < db.sinks.GetN (); ++i)
+    {
+      r.rxBytes += DynamicCast<PacketSink> (db.sinks.Get (i))->GetTotalRx ();
+    }
+  DataRateValue rate;
+  db.bottleneckDevice->GetAttribute ("DataRate", rate);
+  r.bottleneckBps = rate.Get ().GetBitRate ();
+  Simulator::Destroy ();
+
+  cwndFile.close ();
+  qsizeFile.close ();
+  r.traceBytes = 0;
+  if (traces)
+    {
+      for (const std::string &file : files)
+        {
+          r.traceBytes += FileBytes (file);
+        }
+    }
+  return r;
+}
+
+
+int main (int argc, char *argv[])
+{
+    std::string flowList = "10,100,1000,10000";
+    uint32_t maxLeaves = 600;
+    double simTime = 10;
+    bool traces = true;
+    std::string traceDir = "nsplots/bench";
+    std::string jsonFile = "pid-scaling.json";
+
+    CommandLine cmd;
+    cmd.AddValue ("flows", "comma-separated flow counts", flowList);
+    cmd.AddValue ("maxLeaves", "leaves per side (flows share leaves above this)", maxLeaves);
+    cmd.AddValue ("simTime", "simulated time of the flows (s)", simTime);
+    cmd.AddValue ("traces", "write the cwnd, queue size and drop probability traces, as pid-script.cc", traces);
+    cmd.AddValue ("traceDir", "directory of the traces", traceDir);
+    cmd.AddValue ("json", "JSON report file", jsonFile);
+    cmd.Parse (argc, argv);
+
+    std::vector<uint32_t> flows;
+    std::string item;
+    std::istringstream fs (flowList);
+    while (std::getline (fs, item, ','))
+      {
+        flows.push_back (std::stoul (item));
+      }
+
+    std::ostringstream json;
+    json << "{\n  \"benchmark\": \"pid-scaling\",\n  \"simTime\": " << simTime << ",\n  \"maxLeaves\": " << maxLeaves
+         << ",\n  \"traces\": " << (traces ? "true" : "false") << ",\n  \"runs\": [";
+    bool first = true;
+
+    std::cout << std::left << std::setw (8) << "flows" << std::setw (12) << "setup(s)" << std::setw (12) << "run(s)" << std::setw (14) << "events"
+              << std::setw (14) << "events/s" << std::setw (12) << "sim-s/s" << std::setw (14) << "maxRSS(KB)" << std::setw (14) << "traceBytes"
+              << "rxBytes" << std::endl;
+    for (uint32_t n : flows)
+      {
+        int fd[2];
+        NS_ABORT_MSG_IF (pipe (fd) != 0, "pipe failed");
+        std::cout.flush ();
+        pid_t pid = fork ();
+        NS_ABORT_MSG_IF (pid < 0, "fork failed");
+        if (pid == 0)
+          {
+            close (fd[0]);
+            BenchResult r = RunOnce (n, maxLeaves, simTime, traces, traceDir);
+            ssize_t w = write (fd[1], &r, sizeof (r));
+            _exit (w == sizeof (r) ? 0 : 1);
+          }
+        close (fd[1]);
+        BenchResult r;
+        ssize_t got = read (fd[0], &r, sizeof (r));
+        close (fd[0]);
+        int status;
+        struct rusage usage;
+        wait4 (pid, &status, 0, &usage);
+        std::cout << std::setw (8) << n;
+        if (got != sizeof (r))
+          {
+            std::cout << "failed" << std::endl;
+            continue;
+          }
+        double eventsPerSec = r.events / r.runSecs;
+        double simPerWall = r.simSecs / r.runSecs;
+        std::cout << std::setw (12) << r.setupSecs << std::setw (12) << r.runSecs << std::setw (14) << r.events
+                  << std::setw (14) << static_cast<uint64_t> (eventsPerSec) << std::setw (12) << simPerWall
+                  << std::setw (14) << usage.ru_maxrss << std::setw (14) << r.traceBytes << r.rxBytes << std::endl;
+
+        json << (first ? "\n" : ",\n") << "    {\"flows\": " << n << ", \"bottleneckBps\": " << r.bottleneckBps
+             << ", \"setupSecs\": " << r.setupSecs << ", \"runSecs\": " << r.runSecs << ", \"simSecs\": " << r.simSecs
+             << ", \"events\": " << r.events << ", \"eventsPerSec\": " << eventsPerSec << ", \"simSecsPerWallSec\": " << simPerWall
+             << ", \"maxRssKB\": " << usage.ru_maxrss << ", \"traceBytes\": " << r.traceBytes << ", \"rxBytes\": " << r.rxBytes << "}";
+        first = false;
+      }
+    json << "\n  ]\n}\n";
+
+    std::ofstream out (jsonFile.c_str ());
+    out << json.str ();
+    NS_ABORT_MSG_UNLESS (out, "cannot write " << jsonFile);
+    std::cout << "\nreport: " << jsonFile << std::endl;
+    return 0;
+}
@@ -0,0 +1,172 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) October 2021 : R. Olusegun Alli-Oke
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: R. Olusegun Alli-Oke <razkgb2012@gmail.com>, <razak.alli-oke@elizadeuniversity.edu.ng>
+ */
+
+// ===========================================================================
+//
+// Event-scheduler benchmark on the pid-script.cc workload (pid-dumbbell.h) at 60, 600 and 6000 flows: Map, Heap,
+// List, Calendar and TimingWheel schedulers. Each run is a forked child, so that every run starts from the same
+// (empty) ns-3 state. The set-point step is moved to the middle of the run, so that the post-step transient is measured
+// too. Reported per run: setup and run wall time, executed events, events per wall second, and the
+// bytes received by the sinks, which must be the same for all schedulers (they execute the events in the same order).
+//
+// Every scheduler is run at every flow count; a run that exceeds the wall-clock timeout (e.g. the List scheduler, O(n)
+// per insert, at 6000 flows) is reported as such.
+//
+// ./waf --run "pid-scheduler-bench --flows=60,600,6000 --simTime=10 --timeout=1800"
+//
+// This file is to be placed in "\\scratch" folder together with pid-dumbbell.h.
+//
+// ===========================================================================
+
+
+#include "pid-dumbbell.h"
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <csignal>              //SIGALRM
+#include <unistd.h>             //fork, pipe, alarm
+#include <sys/wait.h>           //waitpid
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("PidSchedulerBench");
+
+struct BenchResult
+{
+  double setupSecs;
+  double runSecs;
+  uint64_t events;
+  uint64_t rxBytes;
+};
+
+static BenchResult
+RunOnce (std::string scheduler, uint32_t nFlows, uint32_t maxLeaves, double simTime)
+{
+  typedef std::chrono::steady_clock Clock;
+  ObjectFactory schedulerFactory;
+  schedulerFactory.SetTypeId (scheduler);
+  Simulator::SetScheduler (schedulerFactory);
+
+  DumbbellConfig cfg;
+  cfg.nFlows = nFlows;
+  cfg.maxLeaves = maxLeaves;
+  cfg.cstop = cfg.cstart + simTime;
+  SetPidScriptDefaults (cfg);
+  Config::SetDefault ("ns3::PidQueueDisc::Sstep", TimeValue (Seconds (cfg.cstart + simTime / 2)));   //the step (at cstart + 80 s in pid-script.cc) and its transient within the run
+
+  Clock::time_point t0 = Clock::now ();
+  Dumbbell db = BuildDumbbell (cfg);
+  Clock::time_point t1 = Clock::now ();
+  Simulator::Stop (Seconds (cfg.cstop));
+  Simulator::Run ();
+  Clock::time_point t2 = Clock::now ();
+
+  BenchResult r;
+  r.setupSecs = std::chrono::duration<double> (t1 - t0).count ();
+  r.runSecs = std::chrono::duration<double> (t2 - t1).count ();
+  r.events = Simulator::GetEventCount ();
+  r.rxBytes = 0;
+  for (uint32_t i = 0; i < db.sinks.GetN (); ++i)
+    {
+      r.rxBytes += DynamicCast<PacketSink> (db.sinks.Get (i))->GetTotalRx ();
+    }
+  Simulator::Destroy ();
+  return r;
+}
+
+
+int main (int argc, char *argv[])
+{
+    std::string flowList = "60,600,6000";
+    std::string schedulerList = "ns3::MapScheduler,ns3::HeapScheduler,ns3::ListScheduler,ns3::CalendarScheduler,ns3::TimingWheelScheduler";
+    uint32_t maxLeaves = 600;
+    uint32_t timeout = 1800;            //wall seconds per run (the List scheduler is O(n) per insert), 0 for none
+    double simTime = 10;
+
+    CommandLine cmd;
+    cmd.AddValue ("flows", "comma-separated flow counts", flowList);
+    cmd.AddValue ("schedulers", "comma-separated scheduler types", schedulerList);
+    cmd.AddValue ("maxLeaves", "leaves per side (flows share leaves above this)", maxLeaves);
+    cmd.AddValue ("timeout", "wall-clock limit of each run (s), 0 for none", timeout);
+    cmd.AddValue ("simTime", "simulated time of the flows (s)", simTime);
+    cmd.Parse (argc, argv);
+
+    std::vector<uint32_t> flows;
+    std::vector<std::string> schedulers;
+    std::string item;
+    std::istringstream fs (flowList);
+    while (std::getline (fs, item, ','))
+      {
+        flows.push_back (std::stoul (item));
+      }
+    std::istringstream ss (schedulerList);
+    while (std::getline (ss, item, ','))
+      {
+        schedulers.push_back (item);
+      }
+
+    std::cout << std::left << std::setw (8) << "flows" << std::setw (30) << "scheduler" << std::setw (12) << "setup(s)" << std::setw (12) << "run(s)"
+              << std::setw (14) << "events" << std::setw (14) << "events/s" << "rxBytes" << std::endl;
+    for (uint32_t n : flows)
+      {
+        for (const std::string &scheduler : schedulers)
+          {
+            int fd[2];
+            NS_ABORT_MSG_IF (pipe (fd) != 0, "pipe failed");
+            std::cout.flush ();
+            pid_t pid = fork ();
+            NS_ABORT_MSG_IF (pid < 0, "fork failed");
+            if (pid == 0)
+              {
+                close (fd[0]);
+                alarm (timeout);                //SIGALRM ends the run
+                BenchResult r = RunOnce (scheduler, n, maxLeaves, simTime);
+                ssize_t w = write (fd[1], &r, sizeof (r));
+                _exit (w == sizeof (r) ? 0 : 1);
+              }
+            close (fd[1]);
+            BenchResult r;
+            ssize_t got = read (fd[0], &r, sizeof (r));
+            close (fd[0]);
+            int status;
+            waitpid (pid, &status, 0);
+            std::cout << std::setw (8) << n << std::setw (30) << scheduler;
+            if (got != sizeof (r) && WIFSIGNALED (status) && WTERMSIG (status) == SIGALRM)
+              {
+                std::cout << "timeout (" << timeout << " s)" << std::endl;
+                continue;
+              }
+            if (got != sizeof (r))
+              {
+                std::cout << "failed" << std::endl;
+                continue;
+              }
+            std::cout << std::setw (12) << r.setupSecs << std::setw (12) << r.runSecs << std::setw (14) << r.events
+                      << std::setw (14) << static_cast<uint64_t> (r.events / r.runSecs) << r.rxBytes << std::endl;
+          }
+      }
+
+    return 0;
+}
@@ -71,41 +71,165 @@ schemes in computer networks, Mathematics and Computers in Simulation, submitted
 #include "ns3/flow-monitor-module.h" 
 #include "ns3/config-store-module.h" 
 #include "ns3/rng-seed-manager.h"
+#include "pid-arrivals.h"       //arrival recording for pid-replay.cc
+#include "pid-memory.h"         //memory sampling by consumer
 
 #include <iostream>
+#include <fstream>
 #include <sstream>
 #include <iomanip>
+#include <cmath>
 #include <map>
+#include <vector>
+#include <unistd.h>             //fork
+#include <sys/wait.h>           //waitpid
 
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE ("PidExample");
 
-std::string cwPath = "/NodeList/*/$ns3::TcpL4Protocol/SocketList/0/CongestionWindow" ;   
-
-//trace-sink for cwnd size 
-void CwndChange (Ptr<OutputStreamWrapper> stream0, std::string context, uint32_t oldCwnd, uint32_t newCwnd)
-{   
-  size_t found = context.find("/", 9+1);  
-  *stream0->GetStream ()  << context.substr (10,found-10) << "\t" << Simulator::Now ().GetSeconds () << "\t" << oldCwnd << "\t" << newCwnd << std::endl;      
-}
+//trace-sink for cwnd size, per flow: the flow id is bound at connect time and the records are pushed into the ring of an
+//....AsyncTraceWriter, whose thread formats and writes them (cwndp.dat: node id, time, old cwnd, new cwnd)
+class CwndTracer
+{
+public:
+  CwndTracer (std::string fileName, uint32_t nFlows, uint32_t ringRecords)
+    : m_writer (fileName, false, true, ringRecords), m_nodeIds (nFlows)
+  {
+  }
+
+  //connect the cwnd trace of the (first) TCP socket of a node to flow flowId; string work is done here only
+  void Connect (uint32_t flowId, uint32_t nodeId)
+  {
+    m_nodeIds[flowId] = nodeId;
+    std::ostringstream path;
+    path << "/NodeList/" << nodeId << "/$ns3::TcpL4Protocol/SocketList/0/CongestionWindow";
+    Config::ConnectWithoutContext (path.str (), MakeBoundCallback (&CwndTracer::CwndChange, this, flowId));
+  }
+
+  static void CwndChange (CwndTracer *tracer, uint32_t flowId, uint32_t oldCwnd, uint32_t newCwnd)
+  {
+    tracer->m_writer.Push (AsyncTraceWriter::Record (Simulator::Now ().GetSeconds (), tracer->m_nodeIds[flowId]).AddInt (oldCwnd).AddInt (newCwnd));
+  }
+
+  //write out the pending records and stop the writer thread (before fork, and at the end)
+  void FlushAll (void)
+  {
+    m_writer.Stop ();
+  }
+
+  //continue tracing into another file (e.g. in a forked variant)
+  void Reopen (std::string fileName)
+  {
+    m_writer.Reopen (fileName);
+  }
+
+private:
+  AsyncTraceWriter m_writer;
+  std::vector<uint32_t> m_nodeIds;                //node id of each flow (first column of cwndp.dat)
+};
+
+//output files of the queue-length traces (time, packets), written by AsyncTraceWriter threads; suffix is empty, or the label of a forked variant
+struct QueueTraceFiles
+{
+  AsyncTraceWriter writer1 {"nsplots/Jplots/qsizep.dat"}, writer2 {"nsplots/Jplots/qdsizep.dat"};
+  void Open (std::string suffix)
+  {
+    writer1.Reopen ("nsplots/Jplots/qsizep" + suffix + ".dat");
+    writer2.Reopen ("nsplots/Jplots/qdsizep" + suffix + ".dat");
+  }
+  void Stop (void)
+  {
+    writer1.Stop ();
+    writer2.Stop ();
+  }
+};
 
 //trace-sink for TxQueue ExtQueue (Queuelength, NetDevice)
-static void PktInQueueEQ(Ptr<OutputStreamWrapper> stream1, unsigned int beforeEQ, unsigned int nowEQ ){*stream1->GetStream () << Simulator::Now ().GetSeconds () << "\t" << nowEQ << std::endl;}
+static void PktInQueueEQ(AsyncTraceWriter *writer1, unsigned int beforeEQ, unsigned int nowEQ ){writer1->Push (AsyncTraceWriter::Record (Simulator::Now ().GetSeconds ()).AddInt (nowEQ));}
 
 //trace-sink for QueueDisc IQueue (Queuelength, Qdisc)
-static void PktInQueueIQ(Ptr<OutputStreamWrapper> stream2, unsigned int beforeIQ, unsigned int nowIQ ){*stream2->GetStream () << Simulator::Now ().GetSeconds () << "\t" << nowIQ << std::endl;}
+static void PktInQueueIQ(AsyncTraceWriter *writer2, unsigned int beforeIQ, unsigned int nowIQ ){writer2->Push (AsyncTraceWriter::Record (Simulator::Now ().GetSeconds ()).AddInt (nowIQ));}
 
 //dynamic trace connection
-static void TraceFunc(Ptr<QueueDisc> qdiscPtr, Ptr<Queue<Packet>> extqPtr)
+static void TraceFunc(Ptr<QueueDisc> qdiscPtr, Ptr<Queue<Packet>> extqPtr, CwndTracer *cwndTracer, QueueTraceFiles *qFiles, NodeContainer ncSources)
+{
+  qFiles->Open ("");
+  for (uint32_t i = 0; i < ncSources.GetN (); ++i) { cwndTracer->Connect (i, ncSources.Get (i)->GetId ()); }
+  extqPtr->TraceConnectWithoutContext( "PacketsInQueue", MakeBoundCallback(&PktInQueueEQ, &qFiles->writer1) );
+  qdiscPtr->TraceConnectWithoutContext( "PacketsInQueue", MakeBoundCallback(&PktInQueueIQ, &qFiles->writer2) );
+}
+
+//warm start: send nPackets UDP packets in a burst from the left router, so that the bottleneck queue starts at q0
+static void PrefillBottleneck (Ptr<Node> router, InetSocketAddress dst, uint32_t nPackets, uint32_t size)
 {
-  AsciiTraceHelper asciiTraceHelper;
-  Ptr<OutputStreamWrapper> stream0 = asciiTraceHelper.CreateFileStream ("nsplots/Jplots/cwndp.dat");
-  Ptr<OutputStreamWrapper> stream1 = asciiTraceHelper.CreateFileStream ("nsplots/Jplots/qsizep.dat");
-  Ptr<OutputStreamWrapper> stream2 = asciiTraceHelper.CreateFileStream ("nsplots/Jplots/qdsizep.dat");
-  Config::Connect(cwPath, MakeBoundCallback (&CwndChange, stream0));
-  extqPtr->TraceConnectWithoutContext( "PacketsInQueue", MakeBoundCallback(&PktInQueueEQ, stream1) );
-  qdiscPtr->TraceConnectWithoutContext( "PacketsInQueue", MakeBoundCallback(&PktInQueueIQ, stream2) );
+  Ptr<Socket> socket = Socket::CreateSocket (router, UdpSocketFactory::GetTypeId ());
+  socket->Connect (dst);
+  for (uint32_t i = 0; i < nPackets; ++i) { socket->Send (Create<Packet> (size)); }
+  socket->Close ();
+}
+
+//UDP payload that gives a prefill packet the IP size of a full TCP data segment: MSS + the TCP header with the options carried
+//....by every data segment (timestamps, when enabled by the TcpSocketBase::Timestamp default; SACK blocks only follow losses and
+//....window scaling is only on SYN segments) - the UDP header
+static uint32_t PrefillPayloadSize (uint32_t mss)
+{
+  TcpHeader tcpHeader;
+  struct TypeId::AttributeInformation info;
+  if (TcpSocketBase::GetTypeId ().LookupAttributeByName ("Timestamp", &info) && DynamicCast<const BooleanValue> (info.initialValue)->Get ())
+  {
+    tcpHeader.AppendOption (CreateObject<TcpOptionTS> ());
+  }
+  return mss + tcpHeader.GetSerializedSize () - UdpHeader ().GetSerializedSize ();
+}
+
+//post-step experiment forked from the shared warm-up: its own set-point and PID parameters, and output files with suffix "_label"
+struct ForkVariant
+{
+  std::string label;
+  uint32_t QsizeRefPktsDQ;
+  double a, b, c, d, e;
+};
+
+std::string variantLabel;               //label of the forked variant run by this process (empty in the parent)
+std::vector<pid_t> variantPids;         //forked variants the parent has to wait for
+
+//fork the simulation (just before the step-change) into one child process per variant; the parent continues with the default
+//....configuration. Children share the warm-up memory copy-on-write, so output buffers must be flushed, and the trace writer
+//....threads (which do not survive fork) stopped, before forking; they restart at their next record. Every writer of the
+//....process (this script's and those of all the queue discs, MqPid children included) is stopped by AsyncTraceWriter::StopAll.
+static void ForkVariants (Ptr<QueueDisc> qdiscPtr, CwndTracer *cwndTracer, QueueTraceFiles *qFiles, std::vector<ForkVariant> variants)
+{
+  std::cout.flush ();
+  AsyncTraceWriter::StopAll ();         //also done by the writers' fork handler: the children start with no writer thread running
+
+  for (uint32_t i = 0; i < variants.size (); ++i)
+  {
+    pid_t pid = fork ();
+    NS_ABORT_MSG_IF (pid < 0, "fork failed for variant " << variants[i].label);
+    if (pid > 0)
+    {
+      variantPids.push_back (pid);
+      continue;
+    }
+
+    //child: apply the variant and continue the simulation
+    const ForkVariant &v = variants[i];
+    variantLabel = v.label;
+    variantPids.clear ();
+    qdiscPtr->SetAttribute ("QueueSizeReferenceDQ", QueueSizeValue (QueueSize (QueueSizeUnit::PACKETS, v.QsizeRefPktsDQ)));
+    qdiscPtr->SetAttribute ("a", DoubleValue (v.a));
+    qdiscPtr->SetAttribute ("b", DoubleValue (v.b));
+    qdiscPtr->SetAttribute ("c", DoubleValue (v.c));
+    qdiscPtr->SetAttribute ("d", DoubleValue (v.d));
+    qdiscPtr->SetAttribute ("e", DoubleValue (v.e));
+    NS_ABORT_MSG_UNLESS (DynamicCast<PidQueueDisc> (qdiscPtr)->UpdateCoefficients (), "PID parameters of variant " << v.label << " do not fit the queue disc");
+    qdiscPtr->SetAttribute ("DropProbTraceFile", StringValue ("nsplots/Jplots/dprobp_" + v.label + ".dat"));
+    cwndTracer->Reopen ("nsplots/Jplots/cwndp_" + v.label + ".dat");
+    qFiles->Open ("_" + v.label);
+    std::cout << "forked variant " << v.label << ": qref = " << v.QsizeRefPktsDQ << "\ta = " << v.a << "\tb = " << v.b << "\tc = " << v.c << "\td = " << v.d << "\te = " << v.e << "\n" << std::endl;
+    return;
+  }
 }
 
 //function header for animation
@@ -129,6 +253,13 @@ int main ()
     LogComponentEnable ("PidExample", LOG_LEVEL_INFO);
 
     bool isSack = false;
+    bool useEcn = false;                //ECN: PidQueueDisc marks (instead of drops) ECT packets, TCP sources negotiate ECN
+    bool useBql = false;                //dynamic queue limits (BQL) on the bottleneck TxQueue: the device holds only what keeps the link busy, the backlog sits in the qdisc where PidQueueDisc can drop
+    bool warmStart = false;             //start flows (cwnd, ssthresh), queue and controller at the fluid-model operating point (w0, q0, u0)
+    bool warmStartPrefill = true;       //with warmStart, also pre-fill the bottleneck queue with q0 packets
+    bool recordArrivals = false;        //record the arrivals at the bottleneck queue disc (arrivals.bin) for trace-driven replay in pid-replay.cc; use in open-loop mode
+    bool accountEvents = false;         //count and time the events by handler function (ns3::AccountingSimulatorImpl), reported after Simulator::Run
+    bool sampleMemory = false;          //sample the memory by consumer (TCP buffers and sockets, queue disc items, device queues) every 100 ms, reported after Simulator::Run
     double cstart = 1;                  //secs   //clientApp (source apps) start time
     double tstart = cstart + 0.001;     //secs   //start tracing of congestion window and queue lengths 
     double sstart = cstart + 80;        //secs   //start step-change from linearization equilibrium point (q0) to desired reference queue-length (qref) 
@@ -146,33 +277,72 @@ int main ()
 
 
     uint32_t    nLeafR = 60, nLeafL = 60;
+    std::string bottleneckRate = "15Mbps", bottleneckDelay = "98ms", leafDelay = "1ms";
+
+    //fluid-model operating point (see AQM_param.m): c (packets/s), Tp (propagation RTT), tau0 = q0/c + Tp, w0 = c*tau0/n, u0 = 2/w0^2
+    double cPkts = DataRate (bottleneckRate).GetBitRate () / (8.0 * tcpMSSize);
+    double Tp = 2 * (Time (leafDelay).GetSeconds () + Time (bottleneckDelay).GetSeconds () + Time (leafDelay).GetSeconds ());
+    double tau0 = QsizeRefPktsEQ / cPkts + Tp;
+    double w0 = cPkts * tau0 / nLeafL;
+    if (warmStart)
+    {
+      sstart = cstart + 20 * tau0;      //a few RTTs instead of 80 secs
+      std::cout << "\tWarmStart: " << "\tq0 = " << QsizeRefPktsEQ << "\t\ttau0 = " << tau0 << "\t\tw0 = " << w0 << "\t\tu0 = " << 2 / (w0 * w0) << "\t\tsstart = " << sstart << "\n" << std::endl;
+    }
     
    
     
 NS_LOG_INFO ("\nSETTING DEFAULT PARAMETERS\n"); 
                                                                     
+    //GlobalValue::Bind ("SchedulerType", StringValue ("ns3::TimingWheelScheduler"));      //event scheduler, default is ns3::MapScheduler (see pid-scheduler-bench.cc)
+    if (accountEvents)
+    {
+      GlobalValue::Bind ("SimulatorImplementationType", StringValue ("ns3::AccountingSimulatorImpl"));   //before any event is scheduled
+    }
     Config::SetDefault ("ns3::TcpSocketBase::Sack", BooleanValue (isSack));                 //default is true 
+    Config::SetDefault ("ns3::TcpSocketBase::UseEcn", StringValue (useEcn ? "On" : "Off"));  //default is Off
     Config::SetDefault ("ns3::TcpSocket::DelAckCount", UintegerValue (0));                  //default is 2 packets 
     Config::SetDefault ("ns3::TcpL4Protocol::SocketType", StringValue ("ns3::TcpNewReno")); //default is TcpNewReno
     Config::SetDefault ("ns3::TcpSocketBase::WindowScaling", BooleanValue (false));         //default is true
     Config::SetDefault ("ns3::TcpSocket::RcvBufSize", UintegerValue (65535));               //default is 1131072 bytes  //Sets the AWND
     Config::SetDefault ("ns3::TcpSocketBase::MaxWindowSize", UintegerValue (65535));        //default is  65536 bytes   //limits the RcvBufSize value
-    Config::SetDefault ("ns3::TcpSocket::InitialCwnd", UintegerValue (1));                  //default is 1 packet size  //equilibrium point w0
+    Config::SetDefault ("ns3::TcpSocket::InitialCwnd", UintegerValue (warmStart ? std::round (w0) : 1));                     //default is 1 packet size  //equilibrium point w0
+    if (warmStart)
+    {
+      Config::SetDefault ("ns3::TcpSocket::InitialSlowStartThreshold", UintegerValue (std::round (w0) * tcpMSSize));   //default is UINT32_MAX bytes
+    }
     Config::SetDefault ("ns3::TcpSocket::SegmentSize", UintegerValue (tcpMSSize));          //default is 536 Bytes
 
     Config::SetDefault ("ns3::QueueBase::MaxSize", QueueSizeValue (QueueSize (QueueSizeUnit::PACKETS, maxQueuePackets)));
     Config::SetDefault ("ns3::PidQueueDisc::MaxSize", QueueSizeValue (QueueSize (QueueSizeUnit::PACKETS, qDiscLimitPkts))); 
     Config::SetDefault ("ns3::PidQueueDisc::QueueSizeReferenceEQ", QueueSizeValue (QueueSize (QueueSizeUnit::PACKETS, QsizeRefPktsEQ))); 
     Config::SetDefault ("ns3::PidQueueDisc::QueueSizeReferenceDQ", QueueSizeValue (QueueSize (QueueSizeUnit::PACKETS, QsizeRefPktsDQ)));
+    Config::SetDefault ("ns3::PidQueueDisc::UseEcn", BooleanValue (useEcn));
+    Config::SetDefault ("ns3::PidQueueDisc::QueueSizeMeasurement", StringValue (useBql ? "Total" : "Device"));   //with BQL the device queue is short: control the backlog of qdisc + device
+    //Config::SetDefault ("ns3::PidQueueDisc::EcnDropThreshold", DoubleValue (0.1));        //drop (instead of mark) ECT packets above this drop probability
+    //byte mode (mixed packet sizes): MaxSize, QueueSizeReferenceEQ and QueueSizeReferenceDQ all in bytes, e.g. QueueSize (QueueSizeUnit::BYTES, qDiscLimitPkts * (tcpMSSize + 40)),
+    //and MeanPktSize = tcpMSSize + 40; the error is then in bytes, so the gains c, d and e are divided by the mean packet size
+    //Config::SetDefault ("ns3::PidQueueDisc::MeanPktSize", UintegerValue (tcpMSSize + 40));
 
       //PID (see equation 15)
       double T, u0, a, b, c, d, e;
       T = 0.00625;  u0 = 0.0085;
-      //a = 1; b = 0; c = -18.22*(0.000001); d = +18.16*(0.000001);  e = 0;  //Hollot2002, (see equation 16)
-      //a = 1; b = 0; c = -35.28*(0.000001); d = +35.22*(0.000001);  e = 0;  //Ustebay2007, (see equation 16)
-      a = 1.8290; b = -0.8290; c = -0.0002556; d = +0.0005043;  e = -0.0002487;  //Kahe2014, (see equation 16)
+      if (warmStart)
+      {
+        u0 = 2 / (w0 * w0);             //the controller starts at the same fluid-model operating point as the flows (w0) and the queue (q0)
+      }
+      //a = 1; b = 0; c = -18.22*(0.000001); d = +18.16*(0.000001);  e = 0;  //Hollot2002, (see equation 16)      ... use qDiscType "ns3::PidQueueDisc<PI>"
+      //a = 1; b = 0; c = -35.28*(0.000001); d = +35.22*(0.000001);  e = 0;  //Ustebay2007, (see equation 16)     ... use qDiscType "ns3::PidQueueDisc<PI>"
+      a = 1.8290; b = -0.8290; c = -0.0002556; d = +0.0005043;  e = -0.0002487;  //Kahe2014, (see equation 16)    ... use qDiscType "ns3::PidQueueDisc<PID>"
+      std::string qDiscType = "ns3::PidQueueDisc<PID>";   //controller specialized at compile time: "ns3::PidQueueDisc<PI>", "<PD>", "<PID>" or "<Generic>" (same as "ns3::PidQueueDisc")
 
       std::cout << "\tDiscretePIDparameters: " << "\tu0 = " << u0 << "\t\ta = " << a << "\t\tb = " << b << "\t\tc = " << c << "\t\td = " << d << "\t\te = " << e << "\n" << std::endl;
+      //post-step variants forked from one shared warm-up (see ForkVariants); empty --> a single run
+      std::vector<ForkVariant> forkVariants;
+      //forkVariants.push_back ({"qref375", 375, a, b, c, d, e});
+      //forkVariants.push_back ({"qref575", 575, a, b, c, d, e});
+      //forkVariants.push_back ({"Hollot2002", QsizeRefPktsDQ, 1, 0, -18.22*(0.000001), +18.16*(0.000001), 0});   //with qDiscType "ns3::PidQueueDisc<Generic>" or "<PID>"
+
       std::cout << "\tDifferenceEquationPID: " << "\t" << "uk  =  u0  +  ( a * u_{k-1} )  +  ( b * u_{k-2} )  +  ( c * e_{k} )  +  ( d * e_{k-1} )  +  ( e * e_{k-2} )" << "\n" << std::endl;
 
       /* The snippet here is implemented in the PidQueueDisc.cc file placed in "\\src\\traffic-control\\model" folder
@@ -191,9 +361,19 @@ NS_LOG_INFO ("\nSETTING DEFAULT PARAMETERS\n");
     Config::SetDefault ("ns3::PidQueueDisc::d", DoubleValue (d));
     Config::SetDefault ("ns3::PidQueueDisc::e", DoubleValue (e));
     Config::SetDefault ("ns3::PidQueueDisc::u0", DoubleValue (u0));                         //linearization equilibrium point of drop probability
+    Config::SetDefault ("ns3::PidQueueDisc::WarmStart", BooleanValue (warmStart));           //drop with u0 from the start (even in open loop), controller history at the operating point
+    //Config::SetDefault ("ns3::PidQueueDisc::NumeratorCoefficients", StringValue ("-0.0002556 0.0005043 -0.0002487"));   //arbitrary-order controller (overrides a..e): errors e_k, e_{k-1}, ...
+    //Config::SetDefault ("ns3::PidQueueDisc::DenominatorCoefficients", StringValue ("1.8290 -0.8290"));                  //arbitrary-order controller (overrides a..e): outputs u_{k-1}, u_{k-2}, ...
+    //Config::SetDefault ("ns3::PidQueueDisc::AntiWindup", BooleanValue (true));                                           //store saturated drop probability in controller history
     Config::SetDefault ("ns3::PidQueueDisc::Tupdate", TimeValue (Seconds (T)));             //compute drop probability every T secs. (1/T sampling frequency of discrete PID controller)
     Config::SetDefault ("ns3::PidQueueDisc::Supdate", TimeValue (Seconds (pstart)));        //start to compute drop ratio
     Config::SetDefault ("ns3::PidQueueDisc::Sstep", TimeValue (Seconds (sstart)));          //start step-change from linearization equilibrium point (q0) to desired reference queue-length (qref)
+    //Config::SetDefault ("ns3::PidQueueDisc::UseQueueDelay", BooleanValue (true));                                //control the sojourn time (ms) of the qdisc queue instead of its length; gains hold across bottleneck rates
+    //Config::SetDefault ("ns3::PidQueueDisc::QueueDelayReferenceEQ", TimeValue (Seconds (QsizeRefPktsEQ * 8.0 * tcpMSSize / 15e6)));   //q0 / bottleneck rate
+    //Config::SetDefault ("ns3::PidQueueDisc::QueueDelayReferenceDQ", TimeValue (Seconds (QsizeRefPktsDQ * 8.0 * tcpMSSize / 15e6)));   //qref / bottleneck rate ; multiply c, d, e by the rate in packets/ms (3.75)
+    //Config::SetDefault ("ns3::PidQueueDisc::SteadyStateWindow", UintegerValue (800));                            //detect convergence over 5 s windows after the step
+    //Config::SetDefault ("ns3::PidQueueDisc::StopOnSteadyState", BooleanValue (true));                             //...and stop once SteadyStateSamples steady samples are collected
+    //Config::SetDefault ("ns3::PidQueueDisc::UsePWM", BooleanValue (true));                 //deterministic (pulse-width-modulated) drops with duty cycle m_dropProb, no rng; allows a longer Tupdate
 
 
     //delete previous-simulation output-data files
@@ -219,7 +399,7 @@ NS_LOG_INFO ("CREATING DUMBELL TOPOLOGY\n");
         PointToPointHelper p2pLeafLinkL;
         p2pLeafLinkL.SetQueue ("ns3::DropTailQueue");  // MaxSize is set by Config::SetDefault("ns3::QueueBase.....), see above.
         p2pLeafLinkL.SetDeviceAttribute    ("DataRate", StringValue ("30Mbps"));
-        p2pLeafLinkL.SetChannelAttribute   ("Delay", StringValue ("1ms")); 
+        p2pLeafLinkL.SetChannelAttribute   ("Delay", StringValue (leafDelay)); 
         NetDeviceContainer dLeft, devLeftLeaf, devLeftRouterL;
         for (uint32_t i = 0; i < nLeafL; ++i)
         {
@@ -231,8 +411,8 @@ NS_LOG_INFO ("CREATING DUMBELL TOPOLOGY\n");
     // Create the point-to-point bottleneck-link
         PointToPointHelper bottleNeckLink;
         bottleNeckLink.SetQueue ("ns3::DropTailQueue");  // MaxSize is set by Config::SetDefault("ns3::QueueBase.....), see above.
-        bottleNeckLink.SetDeviceAttribute  ("DataRate", StringValue ("15Mbps")); 
-        bottleNeckLink.SetChannelAttribute ("Delay", StringValue ("98ms"));
+        bottleNeckLink.SetDeviceAttribute  ("DataRate", StringValue (bottleneckRate)); 
+        bottleNeckLink.SetChannelAttribute ("Delay", StringValue (bottleneckDelay));
         NetDeviceContainer dRouter =  bottleNeckLink.Install(ncRouter.Get(0), ncRouter.Get(1));
         NetDeviceContainer devLeftRouterR, devRightRouterL;  
         devLeftRouterR.Add(dRouter.Get(0)); 
@@ -242,7 +422,7 @@ NS_LOG_INFO ("CREATING DUMBELL TOPOLOGY\n");
         PointToPointHelper p2pLeafLinkR;
         p2pLeafLinkR.SetQueue ("ns3::DropTailQueue");  // MaxSize is set by Config::SetDefault("ns3::QueueBase.....), see above.
         p2pLeafLinkR.SetDeviceAttribute    ("DataRate", StringValue ("30Mbps"));
-        p2pLeafLinkR.SetChannelAttribute   ("Delay", StringValue ("1ms")); 
+        p2pLeafLinkR.SetChannelAttribute   ("Delay", StringValue (leafDelay)); 
         NetDeviceContainer dRight, devRightRouterR, devRightLeaf;
         for (uint32_t i = 0; i < nLeafR; ++i)
         {
@@ -260,10 +440,14 @@ NS_LOG_INFO ("CREATING DUMBELL TOPOLOGY\n");
         stack.Install(ncRight);                                                                    //automatically aggregates a traffic control layer to every right nodes
                                                                                                                                                                                
         TrafficControlHelper tchBottleneck;  QueueDiscContainer CON_qDiscsLeftRouterR;             //set default qdisc on left and right nodes before "assigning IP address"
-        tchBottleneck.SetRootQueueDisc ("ns3::PidQueueDisc");                                      //default is "ns3::FqCoDelQueueDisc"                                    
+        tchBottleneck.SetRootQueueDisc (qDiscType);                                                //default is "ns3::FqCoDelQueueDisc"                                    
+        if (useBql)
+        {
+          tchBottleneck.SetQueueLimits ("ns3::DynamicQueueLimits", "HoldTime", StringValue ("4ms"));   //byte limit of the bottleneck TxQueue adapted to the link (Linux BQL)
+        }
         CON_qDiscsLeftRouterR = tchBottleneck.Install (devLeftRouterR.Get(0));                     //the TrafficControlHelper Install command requires Ptr< NetDevice as argument   
-         //CON_qDiscsRightRouterR = tchBottleneck.Install (devRightRouterR.Get(0));                //calls PidQueueDisc constructor, which has an event auto-scheduled. So do not uncomment unless you plan to use, becoz if... 
-                                                                                                   //... if you delete or remove afterward, the constructor-scheduled-event will attempt to access a null pointer giving error
+         //CON_qDiscsRightRouterR = tchBottleneck.Install (devRightRouterR.Get(0));                //safe to install (and to uninstall, see below): PidQueueDisc schedules its controller events only at its first enqueue... 
+                                                                                                   //... and cancels them on dispose, so a disc that carries no traffic costs no events
 
     NS_LOG_INFO ("\tassigning IP Addresses\n");
    
@@ -355,6 +539,16 @@ NS_LOG_INFO ("CREATING DUMBELL TOPOLOGY\n");
         }
         sinkApps.Start(Seconds(0));                                                                                  //start immediately
         sinkApps.Stop(Seconds(cstop+1.0));                                                                           //stop 1 sec after sourceApp stops  
+
+    // Pre-fill the bottleneck queue with q0 packets (warm start), sent to a UDP sink on the right router
+        if (warmStart && warmStartPrefill)
+        {
+          uint16_t prefillPort = 9;
+          PacketSinkHelper prefillSinkHelper ("ns3::UdpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), prefillPort));
+          ApplicationContainer prefillSink = prefillSinkHelper.Install (ncRouter.Get(1));
+          prefillSink.Start(Seconds(0));
+          Simulator::Schedule (Seconds(cstart), &PrefillBottleneck, ncRouter.Get(0), InetSocketAddress (ipcRightRouterL.GetAddress(0), prefillPort), QsizeRefPktsEQ, PrefillPayloadSize (tcpMSSize));   //same IP size as a TCP data segment
+        }
  
     /*NS_LOG_INFO ("\tinstalling Mobility and Toplogy Animation\n");
 
@@ -389,9 +583,43 @@ NS_LOG_INFO ("ENTERING SIMULATION PHASE\n");
 
 //simulation phase
     std::cout << "***Running the simulation***\n" << std::endl;
-    Simulator::Schedule (Seconds(tstart), &TraceFunc, IntQD, ExtQ);
+    CwndTracer cwndTracer ("nsplots/Jplots/cwndp.dat", nLeafL, 65536);                     //cwnd records go to the writer thread through a ring of 65536 records (2.5 MB)
+    QueueTraceFiles qFiles;
+    Simulator::Schedule (Seconds(tstart), &TraceFunc, IntQD, ExtQ, &cwndTracer, &qFiles, ncLeft);
+    MemorySampler memorySampler (clientApps, sinkApps, MilliSeconds (100));
+    if (sampleMemory)
+    {
+      memorySampler.Start (Seconds (cstart));
+    }
+    NS_ABORT_MSG_IF (recordArrivals && !forkVariants.empty (), "recordArrivals cannot be used with forked variants");
+    ArrivalRecorder *arrivalRecorder = 0;
+    if (recordArrivals)
+    {
+      arrivalRecorder = new ArrivalRecorder ("nsplots/Jplots/arrivals.bin");
+      IntQD->TraceConnectWithoutContext ("Arrival", MakeBoundCallback (&ArrivalRecorder::Record, arrivalRecorder));
+    }
+    if (!forkVariants.empty ())
+    {
+      Simulator::Schedule (Seconds(sstart) - MicroSeconds (1), &ForkVariants, IntQD, &cwndTracer, &qFiles, forkVariants);   //just before QSizeRefUpdate
+    }
     Simulator::Stop (Seconds(cstop+10.0));
     Simulator::Run ();
+    cwndTracer.FlushAll ();
+    qFiles.Stop ();
+    Ptr<AccountingSimulatorImpl> accounting = DynamicCast<AccountingSimulatorImpl> (Simulator::GetImplementation ());
+    if (accounting)
+    {
+      accounting->Report (std::cout);
+    }
+    if (sampleMemory)
+    {
+      memorySampler.Report (std::cout);
+    }
+    delete arrivalRecorder;
+    if (!variantLabel.empty ())
+    {
+      std::cout << "***Variant " << variantLabel << "***" << std::endl;
+    }
 
     //monitor->SerializeToXmlFile("nsplots/Jplots/allTraces/flowM.xml", true, true);         //comment this if above "Additional pcap tracing" section is commented
 
@@ -400,21 +628,37 @@ NS_LOG_INFO ("ENTERING SIMULATION PHASE\n");
     QueueDisc::Stats st = qDiscsLeftRouterR->GetStats ();
     std::cout << st << std::endl;
     
-    if (st.GetNDroppedPackets (PidQueueDisc::UNFORCED_DROP) == 0)
+    if (!useEcn && st.GetNDroppedPackets (PidQueueDisc::UNFORCED_DROP) == 0)
     {
       std::cout << "There should be some unforced drops\n" << std::endl;
     }
+    if (useEcn && st.GetNMarkedPackets (PidQueueDisc::UNFORCED_MARK) == 0)
+    {
+      std::cout << "There should be some unforced marks\n" << std::endl;
+    }
     if (st.GetNDroppedPackets (QueueDisc::INTERNAL_QUEUE_DROP) != 0)
     {
       std::cout << "There should be zero drops due to queue full\n" << std::endl; 
     }
 
+    Ptr<PidQueueDisc> pidQD = DynamicCast<PidQueueDisc> (qDiscsLeftRouterR);
+    if (pidQD && pidQD->GetSteadyStateTime () >= Seconds (0))
+    {
+      std::cout << "Settled at " << pidQD->GetSteadyStateTime ().GetSeconds () << " s, " << pidQD->GetSteadyStateSamples () << " steady-state samples\n" << std::endl;
+    }
+
     std::cout << "***Destroying the simulation***\n" << std::endl;
     Simulator::Destroy ();
 
     Ptr<PacketSink> sink1 = DynamicCast<PacketSink> (sinkApps.Get (0));
     std::cout << "Total Bytes Received by Sink(i) from Source(i): " << sink1->GetTotalRx () << "\n" << std::endl;
 
+    for (uint32_t i = 0; i < variantPids.size (); ++i)
+    {
+      int status;
+      waitpid (variantPids[i], &status, 0);                                                                   //parent waits for the forked variants
+    }
+
     return 0;
 }
 
@@ -0,0 +1,309 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) October 2021 : R. Olusegun Alli-Oke
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: R. Olusegun Alli-Oke <razkgb2012@gmail.com>, <razak.alli-oke@elizadeuniversity.edu.ng>
+ */
+
+// ===========================================================================
+//
+// Behavioural checks of the simulator-independent parts of the PID AQM, run without a network:
+//
+//  - controllers: the difference-equation controllers (CreateDiscreteController, PolicyController<PI/PD/PID>) give
+//    the same drop probabilities, bit for bit, as the baseline CalculateP arithmetic
+//    u = a*u1 + b*u2 + c*e + d*e1 + e*e2, then u0 + u saturated to [0, 1]
+//  - fixed point: FixedPointController follows the double controller with its quantized coefficients, and saturates
+//    (instead of wrapping around) on errors that overflow the accumulator
+//  - PWM: PidAqmCore drops every (1/p)-th arrival, at most one drop per arrival also when the duty is scaled above 1
+//    (byte mode), and with no burst of drops after the duty falls
+//  - timing wheel: TimingWheelScheduler removes the events in the same (timestamp, uid) order as MapScheduler, under
+//    random inserts, removals of the next event and cancellations, at several slot widths
+//  - steady state: SlidingWindowStats gives the mean and standard deviation of the window, also for large values
+//
+// Every check aborts with a message on the first failure; "all checks passed" is printed at the end.
+//
+// ./waf --run "pid-selftest"
+//
+// This file is to be placed in "\\scratch" folder.
+//
+// ===========================================================================
+
+
+#include "ns3/core-module.h"
+#include "ns3/traffic-control-module.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("PidSelfTest");
+
+//baseline CalculateP (pid-queue-disc.cc before the controller core): returns the saturated drop probability
+struct BaselinePid
+{
+  double a, b, c, d, e, u0;
+  double u1 = 0, u2 = 0, e1 = 0, e2 = 0;
+
+  double Update (double err)
+  {
+    double u = (a * u1) + (b * u2) + (c * err) + (d * e1) + (e * e2);
+    u2 = u1;  u1 = u;
+    e2 = e1;  e1 = err;
+    u = u0 + u;
+    double p = (u <= 0) ? 0 : u;
+    return (p <= 1) ? p : 1;
+  }
+};
+
+//queue-size errors of a closed-loop-like run: slow oscillation, noise and a step
+static std::vector<double>
+ErrorSequence (uint32_t n, uint32_t seed)
+{
+  std::mt19937 rng (seed);
+  std::normal_distribution<double> noise (0, 20);
+  std::vector<double> errs;
+  for (uint32_t k = 0; k < n; ++k)
+    {
+      double ref = (k < n / 2) ? 175 : 475;
+      double q = 300 + 200 * std::sin (k * 0.01) + noise (rng);
+      errs.push_back (ref - std::max (q, 0.0));
+    }
+  return errs;
+}
+
+static void
+CheckPolicy (const char *name, std::unique_ptr<DiscreteController> ctrl, BaselinePid base, const std::vector<double> &errs)
+{
+  NS_ABORT_MSG_UNLESS (ctrl, name << ": coefficients rejected");
+  PidAqmCore core;
+  core.SetController (std::move (ctrl));
+  core.Configure (base.u0, false, false);
+  core.Reset (-1);
+  core.SetReference (0);
+  for (uint32_t k = 0; k < errs.size (); ++k)
+    {
+      double expected = base.Update (errs[k]);
+      double p = core.Update (-errs[k]);                        //error = reference - measurement
+      NS_ABORT_MSG_UNLESS (p == expected, name << ": drop probability " << p << " instead of " << expected << " at sample " << k);
+    }
+}
+
+static void
+CheckControllers (void)
+{
+  std::vector<double> errs = ErrorSequence (20000, 1);
+  const double u0 = 0.0085;
+
+  //Kahe2014 PID (pid-script.cc), Hollot2002 PI and a PD, through the generic factory and the policies
+  BaselinePid pid = {1.8290, -0.8290, -0.0002556, 0.0005043, -0.0002487, u0};
+  BaselinePid pi = {1, 0, -18.22e-6, 18.16e-6, 0, u0};
+  BaselinePid pd = {0, 0, -0.0002556, 0.0002487, 0, u0};
+  CheckPolicy ("generic PID", CreateDiscreteController ({pid.c, pid.d, pid.e}, {pid.a, pid.b}), pid, errs);
+  CheckPolicy ("policy PID", CreatePolicyController<PidPolicy> ({pid.c, pid.d, pid.e}, {pid.a, pid.b}), pid, errs);
+  CheckPolicy ("generic PI", CreateDiscreteController ({pi.c, pi.d}, {pi.a}), pi, errs);
+  CheckPolicy ("policy PI", CreatePolicyController<PiPolicy> ({pi.c, pi.d}, {pi.a}), pi, errs);
+  CheckPolicy ("generic PD", CreateDiscreteController ({pd.c, pd.d}, {}), pd, errs);
+  CheckPolicy ("policy PD", CreatePolicyController<PdPolicy> ({pd.c, pd.d}, {}), pd, errs);
+  CheckPolicy ("variable-order PID", std::unique_ptr<DiscreteController> (new VariableOrderController ({pid.c, pid.d, pid.e}, {pid.a, pid.b})), pid, errs);
+  NS_ABORT_MSG_IF (CreatePolicyController<PiPolicy> ({pid.c, pid.d, pid.e}, {pid.a, pid.b}), "PI policy accepted PID coefficients");
+  std::cout << "controllers: bit-identical to the baseline CalculateP" << std::endl;
+}
+
+static void
+CheckFixedPoint (void)
+{
+  const uint32_t coefBits = 24, signalBits = 32;
+  std::vector<double> num = {-0.0002556, 0.0005043, -0.0002487}, den = {1.8290, -0.8290};
+  FixedPointController fixed (num, den, coefBits, signalBits);
+  std::vector<double> qnum, qden;
+  fixed.GetCoefficients (qnum, qden);
+  VariableOrderController ref (qnum, qden);                     //the double controller with the quantized coefficients
+
+  //the difference is the rounding of the signals to Q(signalBits), accumulated by the integrator (pole at 1)
+  double maxDiff = 0;
+  for (double err : ErrorSequence (20000, 2))
+    {
+      maxDiff = std::max (maxDiff, std::fabs (fixed.Update (err) - ref.Update (err)));
+    }
+  NS_ABORT_MSG_UNLESS (maxDiff < 1e-5, "fixed point: output differs from the double path by " << maxDiff);
+
+  //an error far beyond the accumulator range saturates the output, in the direction of the error, without wrapping
+  const double top = FixedPointController::ToDouble (INT64_MAX >> coefBits, signalBits);
+  const double bottom = FixedPointController::ToDouble (INT64_MIN >> coefBits, signalBits);
+  FixedPointController sat ({1e6}, {1}, coefBits, signalBits);
+  double last = 0;
+  for (uint32_t k = 0; k < 100; ++k)
+    {
+      double u = sat.Update (1e9);
+      NS_ABORT_MSG_UNLESS (u >= last && u <= top, "fixed point: output " << u << " after " << last << " (wrapped around)");
+      last = u;
+    }
+  NS_ABORT_MSG_UNLESS (last == top, "fixed point: output " << last << " does not saturate at " << top);
+  for (uint32_t k = 0; k < 100; ++k)
+    {
+      double u = sat.Update (-1e9);
+      NS_ABORT_MSG_UNLESS (u <= last && u >= bottom, "fixed point: output " << u << " after " << last << " (wrapped around)");
+      last = u;
+    }
+  NS_ABORT_MSG_UNLESS (last == bottom, "fixed point: output " << last << " does not saturate at " << bottom);
+  std::cout << "fixed point: follows the double path (max difference " << maxDiff << "), saturates without wrapping" << std::endl;
+}
+
+static void
+CheckPwm (void)
+{
+  PidAqmCore core;
+  core.SetController (CreateDiscreteController ({0}, {}));
+  core.Configure (0, false, true);
+  core.Reset (-1);
+  auto noRng = [] () -> double { NS_FATAL_ERROR ("PWM drew a random value"); return 0; };
+
+  //every (1/p)-th arrival: the gaps between drops are within one arrival of 1/p (the phase is a sum of doubles)
+  for (double p : {0.5, 0.3, 0.1, 0.0085, 0.001})
+    {
+      core.SetDropProb (p);
+      uint32_t drops = 0, gap = 0;
+      const uint32_t n = 100000;
+      for (uint32_t i = 0; i < n; ++i)
+        {
+          ++gap;
+          if (core.DropEarly (noRng))
+            {
+              NS_ABORT_MSG_UNLESS (drops == 0 || std::fabs (gap - 1 / p) < 1 + 1e-9,
+                                   "PWM: gap of " << gap << " arrivals between drops at p = " << p);
+              ++drops;
+              gap = 0;
+            }
+        }
+      NS_ABORT_MSG_UNLESS (std::fabs (drops - n * p) <= 1, "PWM: " << drops << " drops in " << n << " arrivals at p = " << p);
+    }
+
+  //byte mode: a duty scaled above 1 drops every arrival once, and leaves no debt for after the duty falls
+  core.SetDropProb (0.9);
+  for (uint32_t i = 0; i < 1000; ++i)
+    {
+      core.DropEarly (noRng, 3.0);                              //at most one drop per arrival: the phase is capped
+    }
+  core.SetDropProb (0.01);
+  uint32_t drops = 0;
+  for (uint32_t i = 0; i < 200; ++i)
+    {
+      drops += core.DropEarly (noRng) ? 1 : 0;
+    }
+  NS_ABORT_MSG_UNLESS (drops <= 2, "PWM: " << drops << " drops in 200 arrivals at p = 0.01 after a scaled duty above 1");
+  std::cout << "PWM: evenly spaced drops, at most one per arrival, no burst after the duty falls" << std::endl;
+}
+
+static void
+CheckTimingWheel (void)
+{
+  for (uint32_t slotBits : {0, 4, 10})
+    {
+      Ptr<Scheduler> wheel = CreateObjectWithAttributes<TimingWheelScheduler> ("SlotBits", UintegerValue (slotBits));
+      Ptr<Scheduler> map = CreateObject<MapScheduler> ();
+      std::mt19937_64 rng (slotBits + 1);
+      std::vector<Scheduler::Event> pending;                    //may hold events already removed (cancellations skip them)
+      uint64_t now = 0;
+      uint32_t uid = 0, removed = 0, size = 0;
+      for (uint32_t i = 0; i < 300000; ++i)
+        {
+          uint32_t op = rng () % 10;
+          if (op < 5 || size == 0)
+            {
+              //delays from the current slot to the overflow heap, and equal timestamps (ordered by uid)
+              uint32_t r = rng () % 100;
+              uint64_t delay = (r < 40) ? rng () % 2000 : (r < 70) ? rng () % 3000000 : (r < 95) ? rng () % (uint64_t (1) << 36)
+                : (r < 98) ? rng () % (uint64_t (1) << 50) : 0;
+              Scheduler::Event ev;
+              ev.impl = 0;
+              ev.key.m_ts = now + delay;
+              ev.key.m_uid = uid++;
+              ev.key.m_context = 0;
+              wheel->Insert (ev);
+              map->Insert (ev);
+              pending.push_back (ev);
+              ++size;
+            }
+          else if (op < 9)
+            {
+              Scheduler::Event a = wheel->RemoveNext ();
+              Scheduler::Event b = map->RemoveNext ();
+              NS_ABORT_MSG_UNLESS (a.key.m_ts == b.key.m_ts && a.key.m_uid == b.key.m_uid,
+                                   "timing wheel (SlotBits " << slotBits << "): removed event " << a.key.m_uid << " at " << a.key.m_ts
+                                   << " instead of " << b.key.m_uid << " at " << b.key.m_ts);
+              now = a.key.m_ts;
+              ++removed;
+              --size;
+            }
+          else
+            {
+              //cancel a random pending event (if not removed yet: its timestamp is not before the next one)
+              std::size_t j = rng () % pending.size ();
+              Scheduler::Event ev = pending[j];
+              pending[j] = pending.back ();
+              pending.pop_back ();
+              Scheduler::Event next = map->PeekNext ();
+              if (ev.key < next.key)
+                {
+                  continue;                                     //already removed
+                }
+              wheel->Remove (ev);
+              map->Remove (ev);
+              --size;
+            }
+          NS_ABORT_MSG_UNLESS (wheel->IsEmpty () == map->IsEmpty (), "timing wheel (SlotBits " << slotBits << "): emptiness differs");
+          if (!map->IsEmpty ())
+            {
+              NS_ABORT_MSG_UNLESS (wheel->PeekNext ().key.m_uid == map->PeekNext ().key.m_uid,
+                                   "timing wheel (SlotBits " << slotBits << "): next event differs");
+            }
+        }
+      std::cout << "timing wheel (SlotBits " << slotBits << "): " << removed << " events removed in MapScheduler order" << std::endl;
+    }
+}
+
+static void
+CheckSlidingWindowStats (void)
+{
+  SlidingWindowStats w;
+  w.Resize (4);
+  for (uint32_t i = 0; i < 10; ++i)
+    {
+      w.Add (1e9 + (i % 2));                                    //byte-mode sized values: the window is {1e9, 1e9 + 1, ...}
+    }
+  NS_ABORT_MSG_UNLESS (w.IsFull () && w.GetMean () == 1e9 + 0.5 && w.GetStdDev () == 0.5,
+                       "steady state: mean " << w.GetMean () << ", standard deviation " << w.GetStdDev () << " instead of 1e9 + 0.5, 0.5");
+  std::cout << "steady state: window statistics exact for large values" << std::endl;
+}
+
+
+int main (int argc, char *argv[])
+{
+    CommandLine cmd;
+    cmd.Parse (argc, argv);
+
+    CheckControllers ();
+    CheckFixedPoint ();
+    CheckPwm ();
+    CheckTimingWheel ();
+    CheckSlidingWindowStats ();
+    std::cout << "all checks passed" << std::endl;
+    return 0;
+}
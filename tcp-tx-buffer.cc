@@ -26,6 +26,8 @@
 #include "ns3/log.h"
 #include "ns3/abort.h"
 #include "ns3/tcp-option-ts.h"
+#include "ns3/hot-path-timer.h"
+#include "ns3/memory-accounting.h"
 
 #include "tcp-tx-buffer.h"
 
@@ -109,6 +111,7 @@ TcpTxBuffer::~TcpTxBuffer (void)
       TcpTxItem *item = *it;
       m_sentSize -= item->m_packet->GetSize ();
       delete item;
+      MemoryAccounting::Deleted (MemoryAccounting::TCP_TX_ITEM);
     }
 
   for (it = m_appList.begin (); it != m_appList.end (); ++it)
@@ -116,6 +119,7 @@ TcpTxBuffer::~TcpTxBuffer (void)
       TcpTxItem *item = *it;
       m_size -= item->m_packet->GetSize ();
       delete item;
+      MemoryAccounting::Deleted (MemoryAccounting::TCP_TX_ITEM);
     }
 }
 
@@ -182,6 +186,7 @@ TcpTxBuffer::Add (Ptr<Packet> p)
       if (p->GetSize () > 0)
         {
           TcpTxItem *item = new TcpTxItem ();
+          MemoryAccounting::Allocated (MemoryAccounting::TCP_TX_ITEM);
           item->m_packet = p->Copy ();
           m_appList.insert (m_appList.end (), item);
           m_size += p->GetSize ();
@@ -215,6 +220,7 @@ TcpTxBuffer::SizeFromSequence (const SequenceNumber32& seq) const
 Ptr<Packet>
 TcpTxBuffer::CopyFromSequence (uint32_t numBytes, const SequenceNumber32& seq)
 {
+  PID_HOTPATH_TIMER ("TcpTxBuffer::CopyFromSequence");
   NS_LOG_FUNCTION (this << numBytes << seq);
 
   NS_ABORT_MSG_IF (m_firstByteSeq > seq,
@@ -466,6 +472,7 @@ TcpTxBuffer::GetPacketFromList (PacketList &list, const SequenceNumber32 &listSt
                            " and now we recurse because packet ends at "
                                         << beginOfCurrentPacket + currentPacket->GetSize ());
               TcpTxItem *firstPart = new TcpTxItem ();
+              MemoryAccounting::Allocated (MemoryAccounting::TCP_TX_ITEM);
               SplitItems (firstPart, currentItem, seq - beginOfCurrentPacket);
 
               // insert firstPart before currentItem
@@ -519,6 +526,7 @@ TcpTxBuffer::GetPacketFromList (PacketList &list, const SequenceNumber32 &listSt
 
                   MergeItems (previous, currentItem);
                   delete currentItem;
+                  MemoryAccounting::Deleted (MemoryAccounting::TCP_TX_ITEM);
                   if (listEdited)
                     {
                       *listEdited = true;
@@ -532,6 +540,7 @@ TcpTxBuffer::GetPacketFromList (PacketList &list, const SequenceNumber32 &listSt
               // the end is inside the current packet, but it isn't exactly
               // the packet end. Just fragment, fix the list, and return.
               TcpTxItem *firstPart = new TcpTxItem ();
+              MemoryAccounting::Allocated (MemoryAccounting::TCP_TX_ITEM);
               SplitItems (firstPart, currentItem, numBytes);
 
               // insert firstPart before currentItem
@@ -567,6 +576,7 @@ TcpTxBuffer::GetPacketFromList (PacketList &list, const SequenceNumber32 &listSt
           list.erase (it);
 
           delete next;
+          MemoryAccounting::Deleted (MemoryAccounting::TCP_TX_ITEM);
 
           if (listEdited)
             {
@@ -651,6 +661,7 @@ TcpTxBuffer::RemoveFromCounts (TcpTxItem *item, uint32_t size)
 void
 TcpTxBuffer::DiscardUpTo (const SequenceNumber32& seq)
 {
+  PID_HOTPATH_TIMER ("TcpTxBuffer::DiscardUpTo");
   NS_LOG_FUNCTION (this << seq);
 
   // Cases do not need to scan the buffer
@@ -698,6 +709,7 @@ TcpTxBuffer::DiscardUpTo (const SequenceNumber32& seq)
                        " retrans: " << m_retrans << " sacked: " << m_sackedOut <<
                        ". Remaining data " << m_size);
           delete item;
+          MemoryAccounting::Deleted (MemoryAccounting::TCP_TX_ITEM);
         }
       else if (offset > 0)
         { // Part of the packet is behind the seqnum. Fragment
@@ -761,6 +773,7 @@ TcpTxBuffer::DiscardUpTo (const SequenceNumber32& seq)
 bool
 TcpTxBuffer::Update (const TcpOptionSack::SackList &list)
 {
+  PID_HOTPATH_TIMER ("TcpTxBuffer::Update");
   NS_LOG_FUNCTION (this);
   NS_LOG_INFO ("Updating scoreboard, got " << list.size () << " blocks to analyze");
 
@@ -939,6 +952,7 @@ TcpTxBuffer::IsLost (const SequenceNumber32 &seq) const
 bool
 TcpTxBuffer::NextSeg (SequenceNumber32 *seq, bool isRecovery) const
 {
+  PID_HOTPATH_TIMER ("TcpTxBuffer::NextSeg");
   NS_LOG_FUNCTION (this);
   /* RFC 6675, NextSeg definition.
    *
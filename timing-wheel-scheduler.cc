@@ -0,0 +1,264 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) October 2021 : R. Olusegun Alli-Oke
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: R. Olusegun Alli-Oke <razkgb2012@gmail.com>, <razak.alli-oke@elizadeuniversity.edu.ng>
+ */
+
+#include "timing-wheel-scheduler.h"
+#include "ns3/event-impl.h"
+#include "ns3/uinteger.h"
+#include "ns3/assert.h"
+#include "ns3/log.h"
+#include <algorithm>
+
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("TimingWheelScheduler");
+
+NS_OBJECT_ENSURE_REGISTERED (TimingWheelScheduler);
+
+namespace {
+
+//decreasing key order: the next event is at the back of the current slot, and at the front of the overflow heap
+bool
+LaterThan (const Scheduler::Event &a, const Scheduler::Event &b)
+{
+  return b < a;
+}
+
+} // anonymous namespace
+
+TypeId
+TimingWheelScheduler::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::TimingWheelScheduler")
+    .SetParent<Scheduler> ()
+    .SetGroupName ("TrafficControl")
+    .AddConstructor<TimingWheelScheduler> ()
+    .AddAttribute ("SlotBits",
+                   "Log2 of the slot width, in time steps (10: about 1 us with the default ns resolution); "
+                   "not to be changed once events are scheduled",
+                   UintegerValue (10),
+                   MakeUintegerAccessor (&TimingWheelScheduler::m_slotBits),
+                   MakeUintegerChecker<uint32_t> (0, 32))
+  ;
+  return tid;
+}
+
+TimingWheelScheduler::TimingWheelScheduler ()
+  : m_slotBits (10),
+    m_cur (0),
+    m_size (0)
+{
+  NS_LOG_FUNCTION (this);
+  std::fill (&m_used[0][0], &m_used[0][0] + LEVELS * SLOTS / 64, 0);
+}
+
+TimingWheelScheduler::~TimingWheelScheduler ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+TimingWheelScheduler::Insert (const Scheduler::Event &ev)
+{
+  NS_LOG_FUNCTION (this << ev.impl << ev.key.m_ts << ev.key.m_uid);
+  if (m_size == 0)
+    {
+      m_cur = ev.key.m_ts >> m_slotBits;                //all empty: restart the wheels at this event
+    }
+  Place (ev);
+  ++m_size;
+}
+
+bool
+TimingWheelScheduler::IsEmpty (void) const
+{
+  return m_size == 0;
+}
+
+Scheduler::Event
+TimingWheelScheduler::PeekNext (void) const
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (!m_current.empty ());
+  return m_current.back ();
+}
+
+Scheduler::Event
+TimingWheelScheduler::RemoveNext (void)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (!m_current.empty ());
+  Scheduler::Event ev = m_current.back ();
+  m_current.pop_back ();
+  if (--m_size > 0 && m_current.empty ())
+    {
+      Advance ();
+    }
+  return ev;
+}
+
+void
+TimingWheelScheduler::Remove (const Scheduler::Event &ev)
+{
+  NS_LOG_FUNCTION (this << ev.impl << ev.key.m_ts << ev.key.m_uid);
+  uint64_t s = ev.key.m_ts >> m_slotBits;
+  std::vector<Scheduler::Event> *events = &m_overflow;
+  uint32_t level = LEVELS, slot = 0;
+  if (s <= m_cur)
+    {
+      events = &m_current;
+    }
+  else
+    {
+      uint64_t d = s ^ m_cur;
+      for (level = 0; level < LEVELS; ++level)
+        {
+          if ((d >> (8 * (level + 1))) == 0)
+            {
+              slot = (s >> (8 * level)) & (SLOTS - 1);
+              events = &m_wheel[level][slot];
+              break;
+            }
+        }
+    }
+
+  std::vector<Scheduler::Event>::iterator it = events->begin ();
+  while (it != events->end () && it->key.m_uid != ev.key.m_uid)
+    {
+      ++it;
+    }
+  NS_ASSERT_MSG (it != events->end (), "event " << ev.key.m_uid << " not found");
+
+  if (events == &m_current)
+    {
+      m_current.erase (it);                             //keep the order
+    }
+  else if (events == &m_overflow)
+    {
+      m_overflow.erase (it);
+      std::make_heap (m_overflow.begin (), m_overflow.end (), LaterThan);
+    }
+  else
+    {
+      *it = events->back ();
+      events->pop_back ();
+      if (events->empty ())
+        {
+          m_used[level][slot / 64] &= ~(uint64_t (1) << (slot % 64));
+        }
+    }
+  if (--m_size > 0 && m_current.empty ())
+    {
+      Advance ();
+    }
+}
+
+void
+TimingWheelScheduler::Place (const Scheduler::Event &ev)
+{
+  uint64_t s = ev.key.m_ts >> m_slotBits;
+  if (s <= m_cur)
+    {
+      m_current.insert (std::upper_bound (m_current.begin (), m_current.end (), ev, LaterThan), ev);
+      return;
+    }
+  uint64_t d = s ^ m_cur;                               //the highest differing byte gives the wheel
+  for (uint32_t level = 0; level < LEVELS; ++level)
+    {
+      if ((d >> (8 * (level + 1))) == 0)
+        {
+          uint32_t slot = (s >> (8 * level)) & (SLOTS - 1);
+          m_wheel[level][slot].push_back (ev);
+          m_used[level][slot / 64] |= uint64_t (1) << (slot % 64);
+          return;
+        }
+    }
+  m_overflow.push_back (ev);
+  std::push_heap (m_overflow.begin (), m_overflow.end (), LaterThan);
+}
+
+uint32_t
+TimingWheelScheduler::FindSlot (uint32_t level, uint32_t from) const
+{
+  for (uint32_t w = from / 64; w < SLOTS / 64; ++w)
+    {
+      uint64_t bits = m_used[level][w];
+      if (w == from / 64)
+        {
+          bits &= ~uint64_t (0) << (from % 64);
+        }
+      if (bits != 0)
+        {
+          return w * 64 + __builtin_ctzll (bits);
+        }
+    }
+  return SLOTS;
+}
+
+void
+TimingWheelScheduler::Advance (void)
+{
+  NS_LOG_FUNCTION (this);
+  while (m_current.empty ())
+    {
+      bool found = false;
+      for (uint32_t level = 0; level < LEVELS && !found; ++level)
+        {
+          uint32_t shift = 8 * level;
+          uint32_t slot = FindSlot (level, ((m_cur >> shift) & (SLOTS - 1)) + 1);
+          if (slot == SLOTS)
+            {
+              continue;                                 //the lower wheels are empty too: look further ahead
+            }
+          found = true;
+          m_cur = ((m_cur >> (shift + 8)) << (shift + 8)) | (uint64_t (slot) << shift);
+          m_used[level][slot / 64] &= ~(uint64_t (1) << (slot % 64));
+          if (level == 0)
+            {
+              m_current.swap (m_wheel[0][slot]);        //all in the new current slot
+              std::sort (m_current.begin (), m_current.end (), LaterThan);
+            }
+          else
+            {
+              m_cascade.swap (m_wheel[level][slot]);    //spread over the lower wheels (and the current slot)
+              for (std::vector<Scheduler::Event>::const_iterator it = m_cascade.begin (); it != m_cascade.end (); ++it)
+                {
+                  Place (*it);
+                }
+              m_cascade.clear ();
+            }
+        }
+      if (!found)
+        {
+          //wheels empty: restart them at the earliest overflow event and take in the overflow events they can hold
+          NS_ASSERT (!m_overflow.empty ());
+          m_cur = m_overflow.front ().key.m_ts >> m_slotBits;
+          while (!m_overflow.empty () && ((m_overflow.front ().key.m_ts >> m_slotBits) >> (8 * LEVELS)) == (m_cur >> (8 * LEVELS)))
+            {
+              std::pop_heap (m_overflow.begin (), m_overflow.end (), LaterThan);
+              Scheduler::Event ev = m_overflow.back ();
+              m_overflow.pop_back ();
+              Place (ev);
+            }
+        }
+    }
+}
+
+} // namespace ns3
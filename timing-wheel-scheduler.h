@@ -0,0 +1,100 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) October 2021 : R. Olusegun Alli-Oke
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: R. Olusegun Alli-Oke <razkgb2012@gmail.com>, <razak.alli-oke@elizadeuniversity.edu.ng>
+ */
+
+
+#ifndef TIMING_WHEEL_SCHEDULER_H
+#define TIMING_WHEEL_SCHEDULER_H
+
+#include "ns3/scheduler.h"
+#include <stdint.h>
+#include <vector>
+
+
+namespace ns3 {
+
+/**
+ * \ingroup traffic-control
+ *
+ * \brief Hierarchical timing-wheel event scheduler, for event loads dominated by short regular timers (AQM updates,
+ *        TCP timers, link transmit-complete events).
+ *
+ * Time is divided into slots of 2^SlotBits time steps. Events of the current slot are kept sorted; later events go
+ * into one of four wheels of 256 slots (slot, 256 slots, 256^2 slots, 256^3 slots ahead) and are cascaded to the
+ * lower wheels when the current slot reaches them; events further ahead are kept in an overflow heap. Insertion and
+ * removal of the next event are O(1) amortized, and events are removed in the same (timestamp, uid) order as with the
+ * other schedulers, so simulations are reproducible across schedulers.
+ *
+ * Select with GlobalValue::Bind ("SchedulerType", StringValue ("ns3::TimingWheelScheduler")).
+ */
+class TimingWheelScheduler : public Scheduler
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  TimingWheelScheduler ();
+  virtual ~TimingWheelScheduler ();
+
+  // Inherited
+  virtual void Insert (const Scheduler::Event &ev);
+  virtual bool IsEmpty (void) const;
+  virtual Scheduler::Event PeekNext (void) const;
+  virtual Scheduler::Event RemoveNext (void);
+  virtual void Remove (const Scheduler::Event &ev);
+
+private:
+  static const uint32_t LEVELS = 4;                     //!< number of wheels
+  static const uint32_t SLOTS = 256;                    //!< slots per wheel
+
+  /**
+   * \brief Put an event in the current slot, a wheel or the overflow heap, relative to the current slot
+   * \param ev the event
+   */
+  void Place (const Scheduler::Event &ev);
+
+  /**
+   * \brief Move the current slot forward to the next non-empty slot (cascading the wheels) and sort its events
+   */
+  void Advance (void);
+
+  /**
+   * \brief Find the next non-empty slot of a wheel
+   * \param level the wheel
+   * \param from first slot to look at
+   * \returns the slot, or SLOTS if there is none
+   */
+  uint32_t FindSlot (uint32_t level, uint32_t from) const;
+
+  uint32_t m_slotBits;                                  //!< log2 of the slot width (time steps)
+  uint64_t m_cur;                                       //!< current slot number
+  uint32_t m_size;                                      //!< number of events
+  std::vector<Scheduler::Event> m_current;              //!< events of the current (and earlier) slots, sorted by decreasing key
+  std::vector<Scheduler::Event> m_wheel[LEVELS][SLOTS]; //!< events of the later slots, unsorted
+  uint64_t m_used[LEVELS][SLOTS / 64];                  //!< bitmap of the non-empty slots of each wheel
+  std::vector<Scheduler::Event> m_overflow;             //!< events beyond the last wheel, min-heap
+  std::vector<Scheduler::Event> m_cascade;              //!< events of the slot being cascaded (storage reused)
+};
+
+} // namespace ns3
+
+#endif /* TIMING_WHEEL_SCHEDULER_H */